@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #endif
 #include <stddef.h>
+#include <stdint.h>
 
 #if !defined(CLOWNAUDIO_EXPORT) && !defined(CLOWNAUDIO_NO_EXPORT)
 #include "clownaudio_export.h"
@@ -39,11 +40,29 @@ typedef struct ClownAudio_Sound ClownAudio_Sound;
 typedef struct ClownAudio_SoundData ClownAudio_SoundData;
 typedef unsigned int ClownAudio_SoundID;
 
+typedef struct ClownAudio_LoadStats
+{
+	unsigned long files;        // How many files were loaded, including ones that failed
+	unsigned long probes;       // How many decoders were tried on them
+	unsigned long sniff_misses; // How many files couldn't be loaded by the decoders that their signature pointed to
+} ClownAudio_LoadStats;
+
+typedef enum ClownAudio_Resampler
+{
+	CLOWNAUDIO_RESAMPLER_DEFAULT, // miniaudio's linear resampler, with a low-pass filter
+	CLOWNAUDIO_RESAMPLER_NEAREST, // The cheapest, but aliases badly
+	CLOWNAUDIO_RESAMPLER_LINEAR,  // Cheap linear interpolation, without a low-pass filter
+	CLOWNAUDIO_RESAMPLER_SINC     // Polyphase windowed-sinc - the best quality, but the most expensive
+} ClownAudio_Resampler;
+
 typedef struct ClownAudio_SoundDataConfig
 {
 	bool predecode;             // If true, the sound *may* be predecoded if possible. If not, the sound will still be loaded, albeit not predecoded.
 	bool must_predecode;        // If true, the sound *must* be predecoded if possible. If not, the function will fail.
 	bool dynamic_sample_rate;   // If sound is predecoded, then this needs to be true for `ClownAudio_SetSoundSampleRate` to work
+	bool memory_map;            // If true, `ClownAudio_Mixer_LoadSoundDataFromFiles` maps the files into memory instead of reading them, on platforms that support it. The files must not be modified while they are loaded.
+	ClownAudio_Resampler resampler; // Used when the sound is resampled as it is predecoded
+	ClownAudio_LoadStats *stats; // If not NULL, the load's statistics are added to this
 } ClownAudio_SoundDataConfig;
 
 typedef struct ClownAudio_SoundConfig
@@ -51,6 +70,7 @@ typedef struct ClownAudio_SoundConfig
 	bool loop;                  // If true, the sound will loop indefinitely
 	bool do_not_free_when_done; // If true, the sound will not be automatically destroyed once it finishes playing
 	bool dynamic_sample_rate;   // If sound is not predecoded, then this needs to be true for `ClownAudio_SetSoundSampleRate` to work
+	ClownAudio_Resampler resampler; // Used when the sound is resampled as it plays. Sounds that are already at the mixer's sample rate (and don't have `dynamic_sample_rate` enabled) skip resampling entirely.
 } ClownAudio_SoundConfig;
 
 
@@ -88,6 +108,10 @@ CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromMemory
 // If two files are specified and looping is enabled, the sound will loop at the point where the first file ends, and the second one begins.
 CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromFiles(ClownAudio_Mixer *mixer, const char *intro_path, const char *loop_path, ClownAudio_SoundDataConfig *config);
 
+// If the data is a single predecoded file, this outputs its interlaced (L,R ordering) S16 PCM samples and returns true.
+// The samples belong to the data, and are only valid until it is unloaded.
+CLOWNAUDIO_EXPORT bool ClownAudio_SoundData_GetPCM(ClownAudio_SoundData *sound_data, const short **samples, size_t *frames, unsigned long *sample_rate);
+
 // Unloads data. All sounds using the specified data must be destroyed manually before this function is called.
 CLOWNAUDIO_EXPORT void ClownAudio_Mixer_UnloadSoundData(ClownAudio_SoundData *sound_data);
 
@@ -100,6 +124,9 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_UnloadSoundData(ClownAudio_SoundData *so
 CLOWNAUDIO_EXPORT ClownAudio_Sound* ClownAudio_Mixer_CreateSound(ClownAudio_Mixer *mixer, ClownAudio_SoundData *sound_data, ClownAudio_SoundConfig *config);
 
 // Used to create a sound ID from a sound. Must be done only once.
+// Returns 0 if the mixer has no room for the sound, in which case the sound is destroyed.
+// Using the ID of a destroyed sound is safe and does nothing (IDs only get reused once their slot
+// has been reused 65535 times).
 // Must be guarded with mutex.
 CLOWNAUDIO_EXPORT ClownAudio_SoundID ClownAudio_Mixer_RegisterSound(ClownAudio_Mixer *mixer, ClownAudio_Sound *sound);
 
@@ -171,12 +198,19 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_SetSoundSampleRate(ClownAudio_Mixer *mix
 
 // Mix interlaced (L,R ordering) S16 PCM samples into specified S32 buffer (not clamped).
 // Must be guarded with mutex.
-CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, long *output_buffer, size_t frames_to_do);
+CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, int32_t *output_buffer, size_t frames_to_do);
 
 // Output interlaced (L,R ordering) S16 PCM samples into specified S16 buffer (clamped).
 // Must be guarded with mutex.
 CLOWNAUDIO_EXPORT void ClownAudio_Mixer_OutputSamples(ClownAudio_Mixer *mixer, short *output_buffer, size_t frames_to_do);
 
+// Output the sound's own interlaced (L,R ordering) S16 PCM samples into specified S16 buffer, for mixing it
+// somewhere other than `ClownAudio_Mixer_MixSamples` (which must then not be used). Volume, fading, and pausing
+// are not applied, and the sound is not destroyed once it finishes. Returns the number of frames output, which
+// is less than `frames_to_do` once the sound has finished.
+// Must be guarded with mutex.
+CLOWNAUDIO_EXPORT size_t ClownAudio_Sound_GetSamples(ClownAudio_Sound *sound, short *output_buffer, size_t frames_to_do);
+
 
 #ifdef __cplusplus
 }
@@ -22,6 +22,7 @@
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "decoders/common.h"
 #include "predecoder.h"
@@ -64,8 +65,23 @@
 #include "decoders/snes_spc.h"
 #endif
 
-#define DECODER_FUNCTIONS(name) \
+// Formats that can be recognised by their signature, so that the right decoder can be tried first
+enum
+{
+	FORMAT_OGG_VORBIS = 1 << 0,
+	FORMAT_OGG_OPUS = 1 << 1,
+	FORMAT_FLAC = 1 << 2,
+	FORMAT_WAV = 1 << 3,
+	FORMAT_MP3 = 1 << 4,
+	FORMAT_TRACKER = 1 << 5,	// MOD, XM, IT, and S3M
+	FORMAT_SPC = 1 << 6,
+	FORMAT_PXTONE = 1 << 7,
+	FORMAT_PXTONE_NOISE = 1 << 8
+};
+
+#define DECODER_FUNCTIONS(name, formats) \
 { \
+	formats, \
 	Decoder_##name##_Create, \
 	Decoder_##name##_Destroy, \
 	Decoder_##name##_Rewind, \
@@ -81,6 +97,7 @@ typedef enum DecoderType
 
 typedef struct DecoderFunctions
 {
+	unsigned int formats;
 	void* (*Create)(const unsigned char *data, size_t data_size, bool loop, const DecoderSpec *wanted_spec, DecoderSpec *spec);
 	void (*Destroy)(void *decoder);
 	void (*Rewind)(void *decoder);
@@ -106,54 +123,123 @@ struct DecoderSelectorData
 
 static const DecoderFunctions decoder_function_list[] = {
 #ifdef USE_LIBVORBIS
-	DECODER_FUNCTIONS(libVorbis),
+	DECODER_FUNCTIONS(libVorbis, FORMAT_OGG_VORBIS),
 #endif
 #ifdef USE_STB_VORBIS
-	DECODER_FUNCTIONS(STB_Vorbis),
+	DECODER_FUNCTIONS(STB_Vorbis, FORMAT_OGG_VORBIS),
 #endif
 #ifdef USE_DR_MP3
-	DECODER_FUNCTIONS(DR_MP3),
+	DECODER_FUNCTIONS(DR_MP3, FORMAT_MP3),
 #endif
 #ifdef USE_LIBOPUS
-	DECODER_FUNCTIONS(libOpus),
+	DECODER_FUNCTIONS(libOpus, FORMAT_OGG_OPUS),
 #endif
 #ifdef USE_LIBFLAC
-	DECODER_FUNCTIONS(libFLAC),
+	DECODER_FUNCTIONS(libFLAC, FORMAT_FLAC),
 #endif
 #ifdef USE_DR_FLAC
-	DECODER_FUNCTIONS(DR_FLAC),
+	DECODER_FUNCTIONS(DR_FLAC, FORMAT_FLAC),
 #endif
 #ifdef USE_DR_WAV
-	DECODER_FUNCTIONS(DR_WAV),
+	DECODER_FUNCTIONS(DR_WAV, FORMAT_WAV),
 #endif
 #ifdef USE_LIBSNDFILE
-	DECODER_FUNCTIONS(libSndfile),
+	DECODER_FUNCTIONS(libSndfile, FORMAT_WAV | FORMAT_FLAC | FORMAT_OGG_VORBIS),
 #endif
 #ifdef USE_LIBOPENMPT
-	DECODER_FUNCTIONS(libOpenMPT),
+	DECODER_FUNCTIONS(libOpenMPT, FORMAT_TRACKER),
 #endif
 #ifdef USE_LIBXMPLITE
-	DECODER_FUNCTIONS(libXMPLite),
+	DECODER_FUNCTIONS(libXMPLite, FORMAT_TRACKER),
 #endif
 #ifdef USE_PXTONE
-	DECODER_FUNCTIONS(PxTone),
+	DECODER_FUNCTIONS(PxTone, FORMAT_PXTONE),
 #endif
 #ifdef USE_PXTONE
-	DECODER_FUNCTIONS(PxToneNoise),
+	DECODER_FUNCTIONS(PxToneNoise, FORMAT_PXTONE_NOISE),
 #endif
 #ifdef USE_SNES_SPC
-	DECODER_FUNCTIONS(SNES_SPC),
+	DECODER_FUNCTIONS(SNES_SPC, FORMAT_SPC),
 #endif
 };
 
 static const DecoderFunctions predecoder_functions = {
+	0,
 	NULL,
 	Predecoder_Destroy,
 	Predecoder_Rewind,
 	Predecoder_GetSamples
 };
 
-DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *file_buffer, size_t file_size, bool predecode, bool must_predecode, const DecoderSpec *wanted_spec)
+static bool MatchSignature(const unsigned char *file_buffer, size_t file_size, size_t offset, const char *signature)
+{
+	const size_t signature_size = strlen(signature);
+
+	return file_size >= offset + signature_size && memcmp(&file_buffer[offset], signature, signature_size) == 0;
+}
+
+static bool IsModTag(const unsigned char *tag)
+{
+	static const char* const tags[] = {"M.K.", "M!K!", "M&K!", "FLT4", "FLT8", "CD81", "OKTA", "OCTA"};
+
+	for (size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); ++i)
+		if (memcmp(tag, tags[i], 4) == 0)
+			return true;
+
+	// "xCHN" and "xxCH", where the x's are the channel count
+	if (tag[0] >= '0' && tag[0] <= '9' && memcmp(&tag[1], "CHN", 3) == 0)
+		return true;
+
+	if (tag[0] >= '0' && tag[0] <= '9' && tag[1] >= '0' && tag[1] <= '9' && memcmp(&tag[2], "CH", 2) == 0)
+		return true;
+
+	return false;
+}
+
+// Cheaply guesses the file's format from its first few bytes, so that the matching decoders can be tried before
+// all the others. Returns 0 if the file wasn't recognised.
+static unsigned int SniffFormat(const unsigned char *file_buffer, size_t file_size)
+{
+	if (MatchSignature(file_buffer, file_size, 0, "OggS"))
+	{
+		// The first page's packet follows the 27-byte page header and a one-entry segment table
+		if (MatchSignature(file_buffer, file_size, 28, "OpusHead"))
+			return FORMAT_OGG_OPUS;
+		else if (MatchSignature(file_buffer, file_size, 28, "\x01vorbis"))
+			return FORMAT_OGG_VORBIS;
+		else
+			return FORMAT_OGG_VORBIS | FORMAT_OGG_OPUS;
+	}
+
+	if (MatchSignature(file_buffer, file_size, 0, "fLaC"))
+		return FORMAT_FLAC;
+
+	if ((MatchSignature(file_buffer, file_size, 0, "RIFF") || MatchSignature(file_buffer, file_size, 0, "RF64")) && MatchSignature(file_buffer, file_size, 8, "WAVE"))
+		return FORMAT_WAV;
+
+	if (MatchSignature(file_buffer, file_size, 0, "Extended Module: ") || MatchSignature(file_buffer, file_size, 0, "IMPM") || MatchSignature(file_buffer, file_size, 44, "SCRM"))
+		return FORMAT_TRACKER;
+
+	if (file_size >= 1080 + 4 && IsModTag(&file_buffer[1080]))
+		return FORMAT_TRACKER;
+
+	if (MatchSignature(file_buffer, file_size, 0, "SNES-SPC700 Sound File Data"))
+		return FORMAT_SPC;
+
+	if (MatchSignature(file_buffer, file_size, 0, "PTCOLLAGE-") || MatchSignature(file_buffer, file_size, 0, "PTTUNE--"))
+		return FORMAT_PXTONE;
+
+	if (MatchSignature(file_buffer, file_size, 0, "PTNOISE-"))
+		return FORMAT_PXTONE_NOISE;
+
+	// MP3 has no real header, so this goes last: either an ID3v2 tag, or the first frame's sync bits
+	if (MatchSignature(file_buffer, file_size, 0, "ID3") || (file_size >= 2 && file_buffer[0] == 0xFF && (file_buffer[1] & 0xE0) == 0xE0))
+		return FORMAT_MP3;
+
+	return 0;
+}
+
+DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *file_buffer, size_t file_size, bool predecode, bool must_predecode, ResamplerQuality resampler, const DecoderSpec *wanted_spec, DecoderSelectorStats *stats)
 {
 	DecoderType decoder_type;
 	const DecoderFunctions *decoder_functions = NULL;
@@ -161,39 +247,60 @@ DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *file_buffer,
 
 	DecoderSpec spec;
 
-	// Figure out what format this sound is
-	for (size_t i = 0; i < sizeof(decoder_function_list) / sizeof(decoder_function_list[0]); ++i)
-	{
-		void *decoder = decoder_function_list[i].Create(file_buffer, file_size, false, wanted_spec, &spec);
+	// Figure out what format this sound is. Creating a decoder can be expensive, so the ones that match
+	// the file's signature are tried first, and the rest are only tried if those fail.
+	const unsigned int sniffed_format = SniffFormat(file_buffer, file_size);
+
+	void *decoder = NULL;
+	size_t i = 0;
 
-		if (decoder != NULL)
+	for (unsigned int pass = 0; pass < 2 && decoder == NULL; ++pass)
+	{
+		for (i = 0; i < sizeof(decoder_function_list) / sizeof(decoder_function_list[0]); ++i)
 		{
-			decoder_type = spec.is_complex ? DECODER_TYPE_COMPLEX : DECODER_TYPE_SIMPLE;
-			decoder_functions = &decoder_function_list[i];
+			const bool matches_signature = (decoder_function_list[i].formats & sniffed_format) != 0;
 
-			DecoderStage stage;
-			stage.decoder = decoder;
-			stage.Destroy = decoder_functions->Destroy;
-			stage.Rewind = decoder_functions->Rewind;
-			stage.GetSamples = decoder_functions->GetSamples;
-			stage.SetLoop = NULL;
+			if (matches_signature != (pass == 0))
+				continue;
 
-			if (decoder_type == DECODER_TYPE_SIMPLE && (predecode || must_predecode))
-			{
-				predecoder_data = Predecoder_DecodeData(&spec, wanted_spec, &stage);
+			if (stats != NULL)
+				++stats->probes;
 
-				if (predecoder_data != NULL)
-				{
-					decoder_type = DECODER_TYPE_PREDECODER;
-					decoder_functions = &predecoder_functions;
-					break;
-				}
-			}
+			decoder = decoder_function_list[i].Create(file_buffer, file_size, false, wanted_spec, &spec);
 
-			decoder_function_list[i].Destroy(decoder);
+			if (decoder != NULL)
+				break;
+		}
 
-			break;
+		if (pass == 0 && decoder == NULL && stats != NULL)
+			++stats->sniff_misses;
+	}
+
+	if (decoder != NULL)
+	{
+		decoder_type = spec.is_complex ? DECODER_TYPE_COMPLEX : DECODER_TYPE_SIMPLE;
+		decoder_functions = &decoder_function_list[i];
+
+		DecoderStage stage;
+		stage.decoder = decoder;
+		stage.Destroy = decoder_functions->Destroy;
+		stage.Rewind = decoder_functions->Rewind;
+		stage.GetSamples = decoder_functions->GetSamples;
+		stage.SetLoop = NULL;
+
+		if (decoder_type == DECODER_TYPE_SIMPLE && (predecode || must_predecode))
+		{
+			predecoder_data = Predecoder_DecodeData(&spec, wanted_spec, resampler, &stage);
+
+			if (predecoder_data != NULL)
+			{
+				decoder_type = DECODER_TYPE_PREDECODER;
+				decoder_functions = &predecoder_functions;
+			}
 		}
+
+		if (predecoder_data == NULL)
+			decoder_function_list[i].Destroy(decoder);
 	}
 
 	if (decoder_functions != NULL && (!must_predecode || decoder_type == DECODER_TYPE_PREDECODER))
@@ -219,6 +326,11 @@ DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *file_buffer,
 	return NULL;
 }
 
+PredecoderData* DecoderSelector_GetPredecodedData(DecoderSelectorData *data)
+{
+	return data->decoder_type == DECODER_TYPE_PREDECODER ? data->predecoder_data : NULL;
+}
+
 void DecoderSelector_UnloadData(DecoderSelectorData *data)
 {
 	if (data->predecoder_data != NULL)
@@ -23,10 +23,18 @@
 #include <stddef.h>
 
 #include "decoders/common.h"
+#include "predecoder.h"
 
 typedef struct DecoderSelectorData DecoderSelectorData;
 
-DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *data, size_t data_size, bool predecode, bool must_predecode, const DecoderSpec *wanted_spec);
+typedef struct DecoderSelectorStats
+{
+	unsigned long probes;       // How many decoders were tried
+	unsigned long sniff_misses; // How many files couldn't be loaded by the decoders that their signature pointed to
+} DecoderSelectorStats;
+
+DecoderSelectorData* DecoderSelector_LoadData(const unsigned char *data, size_t data_size, bool predecode, bool must_predecode, ResamplerQuality resampler, const DecoderSpec *wanted_spec, DecoderSelectorStats *stats);	// `stats` can be NULL
+PredecoderData* DecoderSelector_GetPredecodedData(DecoderSelectorData *data);	// Returns NULL if the data wasn't predecoded
 void DecoderSelector_UnloadData(DecoderSelectorData *data);
 void* DecoderSelector_Create(DecoderSelectorData *data, bool loop, const DecoderSpec *wanted_spec, DecoderSpec *spec);
 void DecoderSelector_Destroy(void *selector);
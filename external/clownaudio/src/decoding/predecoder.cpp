@@ -50,7 +50,7 @@ struct PredecoderData
 	unsigned long sample_rate;
 };
 
-PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderSpec *out_spec, DecoderStage *stage)
+PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderSpec *out_spec, ResamplerQuality resampler, DecoderStage *stage)
 {
 	MemoryStream *memory_stream = MemoryStream_Create(false);
 
@@ -60,7 +60,7 @@ PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderS
 
 		if (predecoder_data != NULL)
 		{
-			void *resampled_decoder = ResampledDecoder_Create(stage, false, out_spec, in_spec);
+			void *resampled_decoder = ResampledDecoder_Create(stage, false, resampler, out_spec, in_spec);
 
 			if (resampled_decoder != NULL)
 			{
@@ -97,6 +97,13 @@ PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderS
 	return NULL;
 }
 
+void Predecoder_GetData(const PredecoderData *data, const void **decoded_data, size_t *decoded_data_size, unsigned long *sample_rate)
+{
+	*decoded_data = data->decoded_data;
+	*decoded_data_size = data->decoded_data_size;
+	*sample_rate = data->sample_rate;
+}
+
 void Predecoder_UnloadData(PredecoderData *data)
 {
 	free(data->decoded_data);
@@ -23,10 +23,12 @@
 #include <stddef.h>
 
 #include "decoders/common.h"
+#include "resampled_decoder.h"
 
 typedef struct PredecoderData PredecoderData;
 
-PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderSpec *out_spec, DecoderStage *stage);
+PredecoderData* Predecoder_DecodeData(const DecoderSpec *in_spec, const DecoderSpec *out_spec, ResamplerQuality resampler, DecoderStage *stage);
+void Predecoder_GetData(const PredecoderData *data, const void **decoded_data, size_t *decoded_data_size, unsigned long *sample_rate);
 void Predecoder_UnloadData(PredecoderData *data);
 void* Predecoder_Create(PredecoderData *data, bool loop, const DecoderSpec *wanted_spec, DecoderSpec *spec);
 void Predecoder_Destroy(void *predecoder);
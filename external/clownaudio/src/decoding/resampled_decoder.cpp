@@ -20,8 +20,10 @@
 
 #include "resampled_decoder.h"
 
+#include <math.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MA_NO_DECODING
 #define MA_NO_ENCODING
@@ -41,19 +43,121 @@
 
 #define RESAMPLE_BUFFER_SIZE 0x1000
 
+#define SINC_RADIUS 8       // How many zero-crossings of the kernel are used on either side of a sample
+#define SINC_PHASES 0x100   // How many kernels the space between two input frames is split into
+#define SINC_TAPS (SINC_RADIUS * 2)
+
+#ifndef M_PI
+ #define M_PI 3.14159265358979323846
+#endif
+
+typedef enum ResampleMode
+{
+	RESAMPLE_MODE_PASSTHROUGH,	// The rates and channel counts already match, so samples are passed along untouched
+	RESAMPLE_MODE_CONVERTER,	// miniaudio's data converter
+	RESAMPLE_MODE_INTERPOLATE	// The resamplers below, which only do mono-to-stereo and like-for-like channel conversion
+} ResampleMode;
+
 typedef struct ResampledDecoder
 {
 	DecoderStage next_stage;
+	ResampleMode mode;
+	ResamplerQuality quality;
 	ma_data_converter converter;
 	unsigned long sample_rate;
 	size_t in_channel_count;
 	size_t out_channel_count;
+
+	// Only used by RESAMPLE_MODE_INTERPOLATE
+	unsigned long out_sample_rate;	// Unlike `sample_rate`, this is never 0
+	size_t step_frames;	// The step between output frames is step_frames + step_fraction / out_sample_rate input frames,
+	unsigned long step_fraction;	// which keeps it exact, so that the output never drifts
+	unsigned long position_fraction;	// How far between the current input frame and the next one, out of out_sample_rate
+	float fraction_scale;	// 1 / out_sample_rate
+	size_t frames_before;	// How many frames before the current one the resampler reads
+	size_t frames_after;	// How many frames after the current one the resampler reads
+	size_t input_end;	// Where the decoder's last frame ends in `buffer`, once it has ended
+	bool input_ended;
+	float sinc_cutoff;	// Relative to the input's Nyquist frequency
+	float *sinc_table;	// SINC_PHASES + 1 kernels of SINC_TAPS taps each
+
 	short buffer[RESAMPLE_BUFFER_SIZE];
 	size_t buffer_end;
 	size_t buffer_done;
 } ResampledDecoder;
 
-void* ResampledDecoder_Create(DecoderStage *next_stage, bool dynamic_sample_rate, const DecoderSpec *wanted_spec, const DecoderSpec *child_spec)
+// A Blackman-windowed sinc, normalised so that every phase has a gain of 1 - with a cutoff of 1,
+// phase 0 comes out as a single tap of 1, so unresampled frames pass through unchanged
+static void MakeSincTable(float *table, float cutoff)
+{
+	for (unsigned int phase = 0; phase <= SINC_PHASES; ++phase)
+	{
+		float *kernel = &table[phase * SINC_TAPS];
+		double sum = 0.0;
+
+		for (unsigned int tap = 0; tap < SINC_TAPS; ++tap)
+		{
+			const double x = (double)phase / SINC_PHASES - ((double)tap - (SINC_RADIUS - 1));
+			double value;
+
+			if (x == 0.0)
+			{
+				value = cutoff;
+			}
+			else if (fabs(x) >= SINC_RADIUS)
+			{
+				value = 0.0;
+			}
+			else
+			{
+				const double window = 0.42 + 0.5 * cos(M_PI * x / SINC_RADIUS) + 0.08 * cos(2.0 * M_PI * x / SINC_RADIUS);
+				value = sin(M_PI * x * cutoff) / (M_PI * x) * window;
+			}
+
+			kernel[tap] = (float)value;
+			sum += value;
+		}
+
+		for (unsigned int tap = 0; tap < SINC_TAPS; ++tap)
+			kernel[tap] = (float)(kernel[tap] / sum);
+	}
+}
+
+static void UpdateStep(ResampledDecoder *resampled_decoder, unsigned long in_sample_rate)
+{
+	resampled_decoder->step_frames = in_sample_rate / resampled_decoder->out_sample_rate;
+	resampled_decoder->step_fraction = in_sample_rate % resampled_decoder->out_sample_rate;
+
+	// A sample rate of 0 would never move
+	if (resampled_decoder->step_frames == 0 && resampled_decoder->step_fraction == 0)
+		resampled_decoder->step_fraction = 1;
+
+	if (resampled_decoder->quality == RESAMPLER_SINC)
+	{
+		// When downsampling, the cutoff is lowered to the output's Nyquist frequency to stop anything above it from
+		// aliasing. The kernel doesn't get any wider to make up for it, so the roll-off is gentler than when upsampling.
+		const float cutoff = in_sample_rate > resampled_decoder->out_sample_rate ? (float)resampled_decoder->out_sample_rate / in_sample_rate : 1.0f;
+
+		if (cutoff != resampled_decoder->sinc_cutoff)
+		{
+			resampled_decoder->sinc_cutoff = cutoff;
+			MakeSincTable(resampled_decoder->sinc_table, cutoff);
+		}
+	}
+}
+
+static void ResetInterpolation(ResampledDecoder *resampled_decoder)
+{
+	// Start with silence behind the first frame, for the resampler to read
+	memset(resampled_decoder->buffer, 0, resampled_decoder->frames_before * resampled_decoder->in_channel_count * sizeof(short));
+
+	resampled_decoder->buffer_end = resampled_decoder->frames_before;
+	resampled_decoder->buffer_done = resampled_decoder->frames_before;
+	resampled_decoder->position_fraction = 0;
+	resampled_decoder->input_ended = false;
+}
+
+void* ResampledDecoder_Create(DecoderStage *next_stage, bool dynamic_sample_rate, ResamplerQuality quality, const DecoderSpec *wanted_spec, const DecoderSpec *child_spec)
 {
 //	DecoderSpec child_spec;
 //	void *decoder = DecoderSelector_Create(data, loop, wanted_spec, &child_spec);
@@ -65,22 +169,70 @@ void* ResampledDecoder_Create(DecoderStage *next_stage, bool dynamic_sample_rate
 		if (resampled_decoder != NULL)
 		{
 			resampled_decoder->next_stage = *next_stage;
+			resampled_decoder->quality = quality;
+			resampled_decoder->in_channel_count = child_spec->channel_count;
+			resampled_decoder->out_channel_count = wanted_spec->channel_count;
+			resampled_decoder->buffer_end = 0;
+			resampled_decoder->buffer_done = 0;
+			resampled_decoder->sample_rate = wanted_spec->sample_rate;
+			resampled_decoder->out_sample_rate = wanted_spec->sample_rate == 0 ? child_spec->sample_rate : wanted_spec->sample_rate;
+			resampled_decoder->sinc_table = NULL;
 
-			ma_data_converter_config config = ma_data_converter_config_init(ma_format_s16, ma_format_s16, child_spec->channel_count, wanted_spec->channel_count, child_spec->sample_rate, wanted_spec->sample_rate == 0 ? child_spec->sample_rate : wanted_spec->sample_rate);
+			const bool channels_supported = child_spec->channel_count == wanted_spec->channel_count || (child_spec->channel_count == 1 && wanted_spec->channel_count == 2);
 
-			if (dynamic_sample_rate)
-				config.resampling.allowDynamicSampleRate = MA_TRUE;
+			if (!dynamic_sample_rate && child_spec->sample_rate == resampled_decoder->out_sample_rate && child_spec->channel_count == wanted_spec->channel_count)
+			{
+				resampled_decoder->mode = RESAMPLE_MODE_PASSTHROUGH;
 
-			if (ma_data_converter_init(&config, &resampled_decoder->converter) == MA_SUCCESS)
+				return resampled_decoder;
+			}
+			else if (quality != RESAMPLER_DEFAULT && channels_supported && resampled_decoder->in_channel_count * (SINC_TAPS + 1) <= RESAMPLE_BUFFER_SIZE / 2)
 			{
-				resampled_decoder->in_channel_count = child_spec->channel_count;
-				resampled_decoder->out_channel_count = wanted_spec->channel_count;
-				resampled_decoder->buffer_end = 0;
-				resampled_decoder->buffer_done = 0;
-				resampled_decoder->sample_rate = wanted_spec->sample_rate;
+				resampled_decoder->mode = RESAMPLE_MODE_INTERPOLATE;
+				resampled_decoder->fraction_scale = 1.0f / resampled_decoder->out_sample_rate;
+
+				switch (quality)
+				{
+					case RESAMPLER_NEAREST:
+					case RESAMPLER_LINEAR:
+					default:
+						resampled_decoder->frames_before = 0;
+						resampled_decoder->frames_after = 1;
+						break;
+
+					case RESAMPLER_SINC:
+						resampled_decoder->frames_before = SINC_RADIUS - 1;
+						resampled_decoder->frames_after = SINC_RADIUS;
+						resampled_decoder->sinc_cutoff = 0.0f;
+						resampled_decoder->sinc_table = (float*)malloc((SINC_PHASES + 1) * SINC_TAPS * sizeof(float));
+
+						if (resampled_decoder->sinc_table == NULL)
+						{
+							free(resampled_decoder);
+							next_stage->Destroy(next_stage->decoder);
+							return NULL;
+						}
+
+						break;
+				}
+
+				UpdateStep(resampled_decoder, child_spec->sample_rate);
+				ResetInterpolation(resampled_decoder);
 
 				return resampled_decoder;
 			}
+			else
+			{
+				resampled_decoder->mode = RESAMPLE_MODE_CONVERTER;
+
+				ma_data_converter_config config = ma_data_converter_config_init(ma_format_s16, ma_format_s16, child_spec->channel_count, wanted_spec->channel_count, child_spec->sample_rate, resampled_decoder->out_sample_rate);
+
+				if (dynamic_sample_rate)
+					config.resampling.allowDynamicSampleRate = MA_TRUE;
+
+				if (ma_data_converter_init(&config, &resampled_decoder->converter) == MA_SUCCESS)
+					return resampled_decoder;
+			}
 
 			free(resampled_decoder);
 		}
@@ -95,7 +247,10 @@ void ResampledDecoder_Destroy(void *resampled_decoder_void)
 {
 	ResampledDecoder *resampled_decoder = (ResampledDecoder*)resampled_decoder_void;
 
-	ma_data_converter_uninit(&resampled_decoder->converter);
+	if (resampled_decoder->mode == RESAMPLE_MODE_CONVERTER)
+		ma_data_converter_uninit(&resampled_decoder->converter);
+
+	free(resampled_decoder->sinc_table);
 	resampled_decoder->next_stage.Destroy(resampled_decoder->next_stage.decoder);
 	free(resampled_decoder);
 }
@@ -105,6 +260,184 @@ void ResampledDecoder_Rewind(void *resampled_decoder_void)
 	ResampledDecoder *resampled_decoder = (ResampledDecoder*)resampled_decoder_void;
 
 	resampled_decoder->next_stage.Rewind(resampled_decoder->next_stage.decoder);
+
+	if (resampled_decoder->mode == RESAMPLE_MODE_INTERPOLATE)
+		ResetInterpolation(resampled_decoder);
+}
+
+// Makes sure that the frames that the resampler reads around the current one are in the buffer.
+// Returns false once the decoder's frames have all been output.
+static bool FillInterpolationBuffer(ResampledDecoder *resampled_decoder)
+{
+	const size_t channel_count = resampled_decoder->in_channel_count;
+
+	if (resampled_decoder->input_ended && resampled_decoder->buffer_done >= resampled_decoder->input_end)
+		return false;
+
+	if (resampled_decoder->buffer_done + resampled_decoder->frames_after < resampled_decoder->buffer_end)
+		return true;
+
+	// Move the frames that are still needed to the start of the buffer. When the step is large, the
+	// resampler can skip past the end of the buffer, in which case the frames in between are dropped as
+	// they are read.
+	size_t frames_dropped = resampled_decoder->buffer_done - resampled_decoder->frames_before;
+
+	if (frames_dropped > resampled_decoder->buffer_end)
+		frames_dropped = resampled_decoder->buffer_end;
+
+	memmove(resampled_decoder->buffer, &resampled_decoder->buffer[frames_dropped * channel_count], (resampled_decoder->buffer_end - frames_dropped) * channel_count * sizeof(short));
+
+	resampled_decoder->buffer_done -= frames_dropped;
+	resampled_decoder->buffer_end -= frames_dropped;
+
+	if (resampled_decoder->input_ended)
+		resampled_decoder->input_end -= frames_dropped;
+
+	if (!resampled_decoder->input_ended)
+	{
+		const size_t frames_read = resampled_decoder->next_stage.GetSamples(resampled_decoder->next_stage.decoder, &resampled_decoder->buffer[resampled_decoder->buffer_end * channel_count], RESAMPLE_BUFFER_SIZE / channel_count - resampled_decoder->buffer_end);
+
+		resampled_decoder->buffer_end += frames_read;
+
+		if (frames_read == 0)
+		{
+			// Follow the last frame with silence, for the resampler to read
+			resampled_decoder->input_ended = true;
+			resampled_decoder->input_end = resampled_decoder->buffer_end;
+
+			memset(&resampled_decoder->buffer[resampled_decoder->buffer_end * channel_count], 0, resampled_decoder->frames_after * channel_count * sizeof(short));
+			resampled_decoder->buffer_end += resampled_decoder->frames_after;
+
+			if (resampled_decoder->buffer_done >= resampled_decoder->input_end)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static short ClampSample(float sample)
+{
+	if (sample > 32767.0f)
+		return 32767;
+	else if (sample < -32768.0f)
+		return -32768;
+	else
+		return (short)(sample < 0.0f ? sample - 0.5f : sample + 0.5f);
+}
+
+static size_t Interpolate(ResampledDecoder *resampled_decoder, short *buffer, size_t frames_to_do)
+{
+	const size_t in_channel_count = resampled_decoder->in_channel_count;
+	const size_t out_channel_count = resampled_decoder->out_channel_count;
+	const size_t step_frames = resampled_decoder->step_frames;
+	const unsigned long step_fraction = resampled_decoder->step_fraction;
+	const unsigned long out_sample_rate = resampled_decoder->out_sample_rate;
+	const float fraction_scale = resampled_decoder->fraction_scale;
+	const bool mono_to_stereo = in_channel_count == 1 && out_channel_count == 2;
+
+	size_t frames_done = 0;
+
+	while (frames_done != frames_to_do)
+	{
+		while (resampled_decoder->buffer_done + resampled_decoder->frames_after >= resampled_decoder->buffer_end || (resampled_decoder->input_ended && resampled_decoder->buffer_done >= resampled_decoder->input_end))
+			if (!FillInterpolationBuffer(resampled_decoder))
+				return frames_done;
+
+		// Work out how far the resampler can go before the buffer needs filling again. This is kept in
+		// locals, since writing the output could otherwise change the struct as far as the compiler knows.
+		size_t position = resampled_decoder->buffer_done;
+		unsigned long position_fraction = resampled_decoder->position_fraction;
+		size_t position_end = resampled_decoder->buffer_end - resampled_decoder->frames_after;
+
+		if (resampled_decoder->input_ended && position_end > resampled_decoder->input_end)
+			position_end = resampled_decoder->input_end;
+
+		const short *in_buffer = resampled_decoder->buffer;
+		const float *sinc_table = resampled_decoder->sinc_table;
+		const ResamplerQuality quality = resampled_decoder->quality;
+
+		for (; frames_done != frames_to_do && position < position_end; ++frames_done)
+		{
+			const short *frame = &in_buffer[position * in_channel_count];
+			short *output_frame = &buffer[frames_done * out_channel_count];
+
+			switch (quality)
+			{
+				case RESAMPLER_NEAREST:
+				default:
+				{
+					const short *nearest_frame = position_fraction * 2 >= out_sample_rate ? frame + in_channel_count : frame;
+
+					for (size_t channel = 0; channel < in_channel_count; ++channel)
+						output_frame[channel] = nearest_frame[channel];
+
+					break;
+				}
+
+				case RESAMPLER_LINEAR:
+				{
+					const long weight = (long)(position_fraction * fraction_scale * 0x8000);	// 15-bit, so that it can't overflow
+
+					for (size_t channel = 0; channel < in_channel_count; ++channel)
+					{
+						const long sample1 = frame[channel];
+						const long sample2 = frame[in_channel_count + channel];
+
+						output_frame[channel] = (short)(sample1 + (((sample2 - sample1) * weight) >> 15));
+					}
+
+					break;
+				}
+
+				case RESAMPLER_SINC:
+				{
+					// Blend the results of the two nearest kernels
+					const float phase_position = position_fraction * fraction_scale * SINC_PHASES;
+					const unsigned int phase = (unsigned int)phase_position;
+					const float blend = phase_position - phase;
+					const float *kernel1 = &sinc_table[phase * SINC_TAPS];
+					const float *kernel2 = kernel1 + SINC_TAPS;
+
+					for (size_t channel = 0; channel < in_channel_count; ++channel)
+					{
+						const short *taps = frame - (SINC_RADIUS - 1) * in_channel_count + channel;
+
+						float sum1 = 0.0f;
+						float sum2 = 0.0f;
+
+						for (unsigned int tap = 0; tap < SINC_TAPS; ++tap)
+						{
+							sum1 += kernel1[tap] * taps[tap * in_channel_count];
+							sum2 += kernel2[tap] * taps[tap * in_channel_count];
+						}
+
+						output_frame[channel] = ClampSample(sum1 + (sum2 - sum1) * blend);
+					}
+
+					break;
+				}
+			}
+
+			// Mono is copied to both channels
+			if (mono_to_stereo)
+				output_frame[1] = output_frame[0];
+
+			position += step_frames;
+			position_fraction += step_fraction;
+
+			if (position_fraction >= out_sample_rate)
+			{
+				position_fraction -= out_sample_rate;
+				++position;
+			}
+		}
+
+		resampled_decoder->buffer_done = position;
+		resampled_decoder->position_fraction = position_fraction;
+	}
+
+	return frames_done;
 }
 
 size_t ResampledDecoder_GetSamples(void *resampled_decoder_void, short *buffer, size_t frames_to_do)
@@ -113,8 +446,22 @@ size_t ResampledDecoder_GetSamples(void *resampled_decoder_void, short *buffer,
 
 	size_t frames_done = 0;
 
+	if (resampled_decoder->mode == RESAMPLE_MODE_INTERPOLATE)
+		return Interpolate(resampled_decoder, buffer, frames_to_do);
+
 	while (frames_done != frames_to_do)
 	{
+		if (resampled_decoder->mode == RESAMPLE_MODE_PASSTHROUGH)
+		{
+			const size_t frames_read = resampled_decoder->next_stage.GetSamples(resampled_decoder->next_stage.decoder, &buffer[frames_done * resampled_decoder->out_channel_count], frames_to_do - frames_done);
+
+			if (frames_read == 0)
+				return frames_done;	// Sample end
+
+			frames_done += frames_read;
+			continue;
+		}
+
 		if (resampled_decoder->buffer_done == resampled_decoder->buffer_end)
 		{
 			resampled_decoder->buffer_done = 0;
@@ -147,5 +494,18 @@ void ResampledDecoder_SetSampleRate(void *resampled_decoder_void, unsigned long
 {
 	ResampledDecoder *resampled_decoder = (ResampledDecoder*)resampled_decoder_void;
 
-	ma_data_converter_set_rate(&resampled_decoder->converter, sample_rate, resampled_decoder->sample_rate);
+	switch (resampled_decoder->mode)
+	{
+		case RESAMPLE_MODE_PASSTHROUGH:
+			// Sounds without `dynamic_sample_rate` don't support this
+			break;
+
+		case RESAMPLE_MODE_CONVERTER:
+			ma_data_converter_set_rate(&resampled_decoder->converter, sample_rate, resampled_decoder->sample_rate);
+			break;
+
+		case RESAMPLE_MODE_INTERPOLATE:
+			UpdateStep(resampled_decoder, sample_rate);
+			break;
+	}
 }
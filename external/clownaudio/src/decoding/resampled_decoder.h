@@ -24,7 +24,15 @@
 
 #include "decoders/common.h"
 
-void* ResampledDecoder_Create(DecoderStage *next_stage, bool dynamic_sample_rate, const DecoderSpec *wanted_spec, const DecoderSpec *child_spec);
+typedef enum ResamplerQuality
+{
+	RESAMPLER_DEFAULT,	// miniaudio's linear resampler, with a low-pass filter
+	RESAMPLER_NEAREST,
+	RESAMPLER_LINEAR,
+	RESAMPLER_SINC
+} ResamplerQuality;
+
+void* ResampledDecoder_Create(DecoderStage *next_stage, bool dynamic_sample_rate, ResamplerQuality quality, const DecoderSpec *wanted_spec, const DecoderSpec *child_spec);
 void ResampledDecoder_Destroy(void *resampled_decoder);
 void ResampledDecoder_Rewind(void *resampled_decoder);
 size_t ResampledDecoder_GetSamples(void *resampled_decoder, short *buffer, size_t frames_to_do);
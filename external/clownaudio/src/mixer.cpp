@@ -20,14 +20,26 @@
 
 #include "clownaudio/mixer.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+ #include <unistd.h>
+ #if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+  #define HAVE_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+ #endif
+#endif
+
 #include "decoding/decoders/common.h"
 
 #include "decoding/decoder_selector.h"
+#include "decoding/predecoder.h"
 #include "decoding/resampled_decoder.h"
 #include "decoding/split_decoder.h"
 
@@ -39,16 +51,33 @@
 
 #define SCALE(x, scale) (((x) * (scale)) >> 8)
 
+// Sound IDs are an index into the mixer's slot table, with the slot's generation in the upper bits.
+// The generation changes whenever a slot is freed, so IDs of destroyed sounds are never mistaken for
+// whatever sound is in the slot now.
+#define SOUND_ID_INDEX_BITS 16
+#define SOUND_ID_INDEX_MASK ((1u << SOUND_ID_INDEX_BITS) - 1)
+#define MAX_SOUNDS (1u << SOUND_ID_INDEX_BITS)
+
+typedef struct SoundSlot
+{
+	ClownAudio_Sound *sound;	// NULL if the slot is free
+	unsigned int generation;	// Never 0, so that no ID is 0
+	unsigned int next_free;
+} SoundSlot;
+
 struct ClownAudio_Mixer
 {
-	ClownAudio_Sound *sound_list_head;
+	SoundSlot *slots;
+	unsigned int total_slots;
+	unsigned int first_free_slot;	// Equal to `total_slots` if there are no free slots
+	ClownAudio_Sound **sounds;	// Every registered sound, packed together for mixing
+	unsigned int total_sounds;
 	unsigned long sample_rate;
-	ClownAudio_SoundID sound_id_allocator;
 };
 
 struct ClownAudio_Sound
 {
-	struct ClownAudio_Sound *next;
+	unsigned int index;	// Where the sound is in the mixer's `sounds` array
 
 	bool paused;
 	bool free_when_done;
@@ -67,18 +96,65 @@ struct ClownAudio_SoundData
 {
 	DecoderSelectorData *decoder_selector_data[2];
 	unsigned char *file_buffers[2];
+	size_t file_buffer_sizes[2];
+	bool file_buffers_mapped[2];
 };
 
-static bool LoadFileToMemory(const char *path, unsigned char **buffer, size_t *size)
+static bool MapFile(const char *path, unsigned char **buffer, size_t *size)
 {
+#ifdef HAVE_MMAP
 	bool success = false;
 
+	int file = open(path, O_RDONLY);
+
+	if (file != -1)
+	{
+		struct stat file_status;
+
+		// Empty files can't be mapped
+		if (fstat(file, &file_status) == 0 && file_status.st_size > 0)
+		{
+			void *mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+			if (mapping != MAP_FAILED)
+			{
+				*buffer = (unsigned char*)mapping;
+				*size = file_status.st_size;
+				success = true;
+			}
+		}
+
+		// The mapping stays valid after the file is closed
+		close(file);
+	}
+
+	return success;
+#else
+	(void)path;
+	(void)buffer;
+	(void)size;
+
+	return false;
+#endif
+}
+
+static bool LoadFileToMemory(const char *path, unsigned char **buffer, size_t *size, bool memory_map, bool *mapped)
+{
+	bool success = false;
+
+	*mapped = false;
+
 	if (path == NULL)
 	{
 		*buffer = NULL;
 		*size = 0;
 		success = true;
 	}
+	else if (memory_map && MapFile(path, buffer, size))
+	{
+		*mapped = true;
+		success = true;
+	}
 	else
 	{
 		FILE *file = fopen(path, "rb");
@@ -105,20 +181,60 @@ static bool LoadFileToMemory(const char *path, unsigned char **buffer, size_t *s
 	return success;
 }
 
+static void UnloadFileFromMemory(unsigned char *buffer, size_t size, bool mapped)
+{
+#ifdef HAVE_MMAP
+	if (mapped)
+	{
+		munmap(buffer, size);
+		return;
+	}
+#else
+	(void)size;
+	(void)mapped;
+#endif
+
+	free(buffer);
+}
+
 static ClownAudio_Sound* FindSound(ClownAudio_Mixer *mixer, ClownAudio_SoundID sound_id)
 {
-	for (ClownAudio_Sound *sound = mixer->sound_list_head; sound != NULL; sound = sound->next)
-		if (sound->id == sound_id)
-			return sound;
+	const unsigned int slot_index = sound_id & SOUND_ID_INDEX_MASK;
+
+	if (slot_index < mixer->total_slots && mixer->slots[slot_index].sound != NULL && mixer->slots[slot_index].sound->id == sound_id)
+		return mixer->slots[slot_index].sound;
 
 	return NULL;
 }
 
+// Removes the sound from the mixer - the caller still has to destroy it
+static void UnregisterSound(ClownAudio_Mixer *mixer, ClownAudio_Sound *sound)
+{
+	const unsigned int slot_index = sound->id & SOUND_ID_INDEX_MASK;
+	SoundSlot *slot = &mixer->slots[slot_index];
+
+	slot->sound = NULL;
+
+	if (++slot->generation > (UINT_MAX >> SOUND_ID_INDEX_BITS))
+		slot->generation = 1;
+
+	slot->next_free = mixer->first_free_slot;
+	mixer->first_free_slot = slot_index;
+
+	// Fill the gap with the last sound, to keep the array packed
+	ClownAudio_Sound *last_sound = mixer->sounds[--mixer->total_sounds];
+	mixer->sounds[sound->index] = last_sound;
+	last_sound->index = sound->index;
+}
+
 CLOWNAUDIO_EXPORT void ClownAudio_InitSoundDataConfig(ClownAudio_SoundDataConfig *config)
 {
 	config->predecode = false;
 	config->must_predecode = false;
 	config->dynamic_sample_rate = false;
+	config->memory_map = false;
+	config->resampler = CLOWNAUDIO_RESAMPLER_DEFAULT;
+	config->stats = NULL;
 }
 
 CLOWNAUDIO_EXPORT void ClownAudio_InitSoundConfig(ClownAudio_SoundConfig *config)
@@ -126,6 +242,7 @@ CLOWNAUDIO_EXPORT void ClownAudio_InitSoundConfig(ClownAudio_SoundConfig *config
 	config->loop = false;
 	config->do_not_free_when_done = false;
 	config->dynamic_sample_rate = false;
+	config->resampler = CLOWNAUDIO_RESAMPLER_DEFAULT;
 }
 
 CLOWNAUDIO_EXPORT ClownAudio_Mixer* ClownAudio_CreateMixer(unsigned long sample_rate)
@@ -134,11 +251,13 @@ CLOWNAUDIO_EXPORT ClownAudio_Mixer* ClownAudio_CreateMixer(unsigned long sample_
 
 	if (mixer != NULL)
 	{
-		mixer->sound_list_head = NULL;
+		mixer->slots = NULL;
+		mixer->total_slots = 0;
+		mixer->first_free_slot = 0;
+		mixer->sounds = NULL;
+		mixer->total_sounds = 0;
 
 		mixer->sample_rate = sample_rate;
-
-		mixer->sound_id_allocator = 0;
 	}
 
 	return mixer;
@@ -146,15 +265,66 @@ CLOWNAUDIO_EXPORT ClownAudio_Mixer* ClownAudio_CreateMixer(unsigned long sample_
 
 CLOWNAUDIO_EXPORT void ClownAudio_DestroyMixer(ClownAudio_Mixer *mixer)
 {
+	if (mixer != NULL)
+	{
+		free(mixer->slots);
+		free(mixer->sounds);
+	}
+
 	free(mixer);
 }
 
+static ResamplerQuality GetResamplerQuality(ClownAudio_Resampler resampler)
+{
+	switch (resampler)
+	{
+		case CLOWNAUDIO_RESAMPLER_DEFAULT:
+		default:
+			return RESAMPLER_DEFAULT;
+
+		case CLOWNAUDIO_RESAMPLER_NEAREST:
+			return RESAMPLER_NEAREST;
+
+		case CLOWNAUDIO_RESAMPLER_LINEAR:
+			return RESAMPLER_LINEAR;
+
+		case CLOWNAUDIO_RESAMPLER_SINC:
+			return RESAMPLER_SINC;
+	}
+}
+
+static DecoderSelectorData* LoadDecoderSelectorData(const unsigned char *file_buffer, size_t file_size, const ClownAudio_SoundDataConfig *config, const DecoderSpec *wanted_spec)
+{
+	DecoderSelectorStats stats;
+	stats.probes = 0;
+	stats.sniff_misses = 0;
+
+	DecoderSelectorData *data = DecoderSelector_LoadData(file_buffer, file_size, config->predecode, config->must_predecode, GetResamplerQuality(config->resampler), wanted_spec, &stats);
+
+	if (config->stats != NULL)
+	{
+		++config->stats->files;
+		config->stats->probes += stats.probes;
+		config->stats->sniff_misses += stats.sniff_misses;
+	}
+
+	return data;
+}
+
 CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromMemory(ClownAudio_Mixer *mixer, const unsigned char *file_buffer1, size_t file_size1, const unsigned char *file_buffer2, size_t file_size2, ClownAudio_SoundDataConfig *config)
 {
 	ClownAudio_SoundData *sound_data = (ClownAudio_SoundData*)malloc(sizeof(ClownAudio_SoundData));
 
 	if (sound_data != NULL)
 	{
+		// The caller owns the buffers - ClownAudio_Mixer_LoadSoundDataFromFiles replaces these with its own
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			sound_data->file_buffers[i] = NULL;
+			sound_data->file_buffer_sizes[i] = 0;
+			sound_data->file_buffers_mapped[i] = false;
+		}
+
 		DecoderSpec wanted_spec;
 
 		wanted_spec.sample_rate = config->dynamic_sample_rate ? 0 : mixer->sample_rate;	// Do not change the sample rate when dynamic resampling is enabled
@@ -162,8 +332,8 @@ CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromMemory
 
 		if (file_buffer1 != NULL && file_buffer2 != NULL)
 		{
-			sound_data->decoder_selector_data[0] = DecoderSelector_LoadData(file_buffer1, file_size1, config->predecode, config->must_predecode, &wanted_spec);
-			sound_data->decoder_selector_data[1] = DecoderSelector_LoadData(file_buffer2, file_size2, config->predecode, config->must_predecode, &wanted_spec);
+			sound_data->decoder_selector_data[0] = LoadDecoderSelectorData(file_buffer1, file_size1, config, &wanted_spec);
+			sound_data->decoder_selector_data[1] = LoadDecoderSelectorData(file_buffer2, file_size2, config, &wanted_spec);
 
 			if (sound_data->decoder_selector_data[0] != NULL && sound_data->decoder_selector_data[1] != NULL)
 				return sound_data;
@@ -176,7 +346,7 @@ CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromMemory
 		}
 		else if (file_buffer1 != NULL)
 		{
-			sound_data->decoder_selector_data[0] = DecoderSelector_LoadData(file_buffer1, file_size1, config->predecode, config->must_predecode, &wanted_spec);
+			sound_data->decoder_selector_data[0] = LoadDecoderSelectorData(file_buffer1, file_size1, config, &wanted_spec);
 			sound_data->decoder_selector_data[1] = NULL;
 
 			if (sound_data->decoder_selector_data[0] != NULL)
@@ -185,7 +355,7 @@ CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromMemory
 		else if (file_buffer2 != NULL)
 		{
 			sound_data->decoder_selector_data[0] = NULL;
-			sound_data->decoder_selector_data[1] = DecoderSelector_LoadData(file_buffer2, file_size2, config->predecode, config->must_predecode, &wanted_spec);
+			sound_data->decoder_selector_data[1] = LoadDecoderSelectorData(file_buffer2, file_size2, config, &wanted_spec);
 
 			if (sound_data->decoder_selector_data[1] != NULL)
 				return sound_data;
@@ -203,31 +373,58 @@ CLOWNAUDIO_EXPORT ClownAudio_SoundData* ClownAudio_Mixer_LoadSoundDataFromFiles(
 	{
 		unsigned char *file_buffers[2];
 		size_t file_buffer_sizes[2];
+		bool file_buffers_mapped[2];
 
-		if (LoadFileToMemory(intro_path, &file_buffers[0], &file_buffer_sizes[0]))
+		if (LoadFileToMemory(intro_path, &file_buffers[0], &file_buffer_sizes[0], config->memory_map, &file_buffers_mapped[0]))
 		{
-			if (LoadFileToMemory(loop_path, &file_buffers[1], &file_buffer_sizes[1]))
+			if (LoadFileToMemory(loop_path, &file_buffers[1], &file_buffer_sizes[1], config->memory_map, &file_buffers_mapped[1]))
 			{
 				ClownAudio_SoundData *sound_data = ClownAudio_Mixer_LoadSoundDataFromMemory(mixer, file_buffers[0], file_buffer_sizes[0], file_buffers[1], file_buffer_sizes[1], config);
 
 				if (sound_data != NULL)
 				{
-					sound_data->file_buffers[0] = file_buffers[0];
-					sound_data->file_buffers[1] = file_buffers[1];
+					for (unsigned int i = 0; i < 2; ++i)
+					{
+						sound_data->file_buffers[i] = file_buffers[i];
+						sound_data->file_buffer_sizes[i] = file_buffer_sizes[i];
+						sound_data->file_buffers_mapped[i] = file_buffers_mapped[i];
+					}
 
 					return sound_data;
 				}
 
-				free(file_buffers[1]);
+				UnloadFileFromMemory(file_buffers[1], file_buffer_sizes[1], file_buffers_mapped[1]);
 			}
 
-			free(file_buffers[0]);
+			UnloadFileFromMemory(file_buffers[0], file_buffer_sizes[0], file_buffers_mapped[0]);
 		}
 	}
 
 	return NULL;
 }
 
+CLOWNAUDIO_EXPORT bool ClownAudio_SoundData_GetPCM(ClownAudio_SoundData *sound_data, const short **samples, size_t *frames, unsigned long *sample_rate)
+{
+	// Intro/loop pairs are two separate buffers, so they can't be given out as one
+	if (sound_data->decoder_selector_data[0] == NULL || sound_data->decoder_selector_data[1] != NULL)
+		return false;
+
+	PredecoderData *predecoder_data = DecoderSelector_GetPredecodedData(sound_data->decoder_selector_data[0]);
+
+	if (predecoder_data == NULL)
+		return false;
+
+	const void *decoded_data;
+	size_t decoded_data_size;
+
+	Predecoder_GetData(predecoder_data, &decoded_data, &decoded_data_size, sample_rate);
+
+	*samples = (const short*)decoded_data;
+	*frames = decoded_data_size / (sizeof(short) * CHANNEL_COUNT);
+
+	return true;
+}
+
 CLOWNAUDIO_EXPORT void ClownAudio_Mixer_UnloadSoundData(ClownAudio_SoundData *sound_data)
 {
 	if (sound_data != NULL)
@@ -238,8 +435,8 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_UnloadSoundData(ClownAudio_SoundData *so
 		if (sound_data->decoder_selector_data[1] != NULL)
 			DecoderSelector_UnloadData(sound_data->decoder_selector_data[1]);
 
-		free(sound_data->file_buffers[0]);
-		free(sound_data->file_buffers[1]);
+		UnloadFileFromMemory(sound_data->file_buffers[0], sound_data->file_buffer_sizes[0], sound_data->file_buffers_mapped[0]);
+		UnloadFileFromMemory(sound_data->file_buffers[1], sound_data->file_buffer_sizes[1], sound_data->file_buffers_mapped[1]);
 
 		free(sound_data);
 	}
@@ -307,7 +504,7 @@ CLOWNAUDIO_EXPORT ClownAudio_Sound* ClownAudio_Mixer_CreateSound(ClownAudio_Mixe
 		{
 			if (decoder_selectors[i] != NULL)
 			{
-				resampled_decoders[i] = ResampledDecoder_Create(&selector_stages[i], config->dynamic_sample_rate, &wanted_spec, &specs[i]);
+				resampled_decoders[i] = ResampledDecoder_Create(&selector_stages[i], config->dynamic_sample_rate, GetResamplerQuality(config->resampler), &wanted_spec, &specs[i]);
 
 				if (resampled_decoders[i] == NULL)
 				{
@@ -390,40 +587,68 @@ CLOWNAUDIO_EXPORT ClownAudio_Sound* ClownAudio_Mixer_CreateSound(ClownAudio_Mixe
 
 CLOWNAUDIO_EXPORT ClownAudio_SoundID ClownAudio_Mixer_RegisterSound(ClownAudio_Mixer *mixer, ClownAudio_Sound *sound)
 {
-	ClownAudio_SoundID sound_id = 0;
+	if (sound == NULL)
+		return 0;
 
-	if (sound != NULL)
+	// Out of slots - make more
+	if (mixer->first_free_slot == mixer->total_slots && mixer->total_slots != MAX_SOUNDS)
 	{
-		do
+		const unsigned int new_total_slots = mixer->total_slots == 0 ? 0x40 : MIN(mixer->total_slots * 2, MAX_SOUNDS);
+
+		SoundSlot *new_slots = (SoundSlot*)realloc(mixer->slots, new_total_slots * sizeof(SoundSlot));
+
+		if (new_slots != NULL)
 		{
-			sound_id = ++mixer->sound_id_allocator;
-		} while (sound_id == 0);	// Do not let it allocate 0 - it is an error value
+			mixer->slots = new_slots;
 
-		sound->id = sound_id;
+			ClownAudio_Sound **new_sounds = (ClownAudio_Sound**)realloc(mixer->sounds, new_total_slots * sizeof(ClownAudio_Sound*));
 
-		sound->next = mixer->sound_list_head;
-		mixer->sound_list_head = sound;
+			if (new_sounds != NULL)
+			{
+				mixer->sounds = new_sounds;
+
+				for (unsigned int i = mixer->total_slots; i < new_total_slots; ++i)
+				{
+					mixer->slots[i].sound = NULL;
+					mixer->slots[i].generation = 1;
+					mixer->slots[i].next_free = i + 1;
+				}
+
+				mixer->first_free_slot = mixer->total_slots;
+				mixer->total_slots = new_total_slots;
+			}
+		}
 	}
 
-	return sound_id;
+	if (mixer->first_free_slot == mixer->total_slots)
+	{
+		sound->pipeline.Destroy(sound->pipeline.decoder);
+		free(sound);
+		return 0;
+	}
+
+	const unsigned int slot_index = mixer->first_free_slot;
+	SoundSlot *slot = &mixer->slots[slot_index];
+
+	mixer->first_free_slot = slot->next_free;
+
+	slot->sound = sound;
+
+	sound->id = (slot->generation << SOUND_ID_INDEX_BITS) | slot_index;
+	sound->index = mixer->total_sounds;
+	mixer->sounds[mixer->total_sounds++] = sound;
+
+	return sound->id;
 }
 
 CLOWNAUDIO_EXPORT void ClownAudio_Mixer_DestroySound(ClownAudio_Mixer *mixer, ClownAudio_SoundID sound_id)
 {
-	ClownAudio_Sound *sound = NULL;
-
-	for (ClownAudio_Sound **sound_pointer = &mixer->sound_list_head; *sound_pointer != NULL; sound_pointer = &(*sound_pointer)->next)
-	{
-		if ((*sound_pointer)->id == sound_id)
-		{
-			sound = *sound_pointer;
-			*sound_pointer = sound->next;
-			break;
-		}
-	}
+	ClownAudio_Sound *sound = FindSound(mixer, sound_id);
 
 	if (sound != NULL)
 	{
+		UnregisterSound(mixer, sound);
+
 		sound->pipeline.Destroy(sound->pipeline.decoder);
 		free(sound);
 	}
@@ -544,16 +769,16 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_SetSoundSampleRate(ClownAudio_Mixer *mix
 	}
 }
 
-CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, long *output_buffer, size_t frames_to_do)
+CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, int32_t *output_buffer, size_t frames_to_do)
 {
-	ClownAudio_Sound **sound_pointer = &mixer->sound_list_head;
-	while (*sound_pointer != NULL)
+	unsigned int sound_index = 0;
+	while (sound_index < mixer->total_sounds)
 	{
-		ClownAudio_Sound *sound = *sound_pointer;
+		ClownAudio_Sound *sound = mixer->sounds[sound_index];
 
 		if (!sound->paused)
 		{
-			long *output_buffer_pointer = output_buffer;
+			int32_t *output_buffer_pointer = output_buffer;
 
 			size_t frames_done = 0;
 			for (size_t sub_frames_done; frames_done < frames_to_do; frames_done += sub_frames_done)
@@ -607,8 +832,9 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, long
 			{
 				if (sound->free_when_done)
 				{
+					// The last sound takes this one's place, so don't advance
+					UnregisterSound(mixer, sound);
 					sound->pipeline.Destroy(sound->pipeline.decoder);
-					*sound_pointer = sound->next;
 					free(sound);
 					continue;
 				}
@@ -619,7 +845,7 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_MixSamples(ClownAudio_Mixer *mixer, long
 			}
 		}
 
-		sound_pointer = &(*sound_pointer)->next;
+		++sound_index;
 	}
 }
 
@@ -628,11 +854,11 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_OutputSamples(ClownAudio_Mixer *mixer, s
 	size_t frames_done = 0;
 	while (frames_done < frames_to_do)
 	{
-		long mix_buffer[0x1000];
+		int32_t mix_buffer[0x1000];
 
 		const size_t sub_frames_to_do = MIN(0x1000 / CHANNEL_COUNT, frames_to_do - frames_done);
 
-		memset(mix_buffer, 0, sub_frames_to_do * sizeof(long) * CHANNEL_COUNT);
+		memset(mix_buffer, 0, sub_frames_to_do * sizeof(int32_t) * CHANNEL_COUNT);
 		ClownAudio_Mixer_MixSamples(mixer, mix_buffer, sub_frames_to_do);
 
 		// Clamp samples to 16-bit range
@@ -649,3 +875,8 @@ CLOWNAUDIO_EXPORT void ClownAudio_Mixer_OutputSamples(ClownAudio_Mixer *mixer, s
 		frames_done += sub_frames_to_do;
 	}
 }
+
+CLOWNAUDIO_EXPORT size_t ClownAudio_Sound_GetSamples(ClownAudio_Sound *sound, short *output_buffer, size_t frames_to_do)
+{
+	return sound->pipeline.GetSamples(sound->pipeline.decoder, output_buffer, frames_to_do);
+}
@@ -7,10 +7,34 @@
 
 typedef struct AudioBackend_Sound AudioBackend_Sound;
 
-bool AudioBackend_Init(void);
+// Supplies a stream's next `frames` frames of 16-bit stereo at the output frequency.
+// Returns how many it supplied: fewer than `frames` means that the stream has ended.
+typedef size_t (*AudioBackend_StreamCallback)(void *user_data, short *buffer, size_t frames);
+
+typedef enum AudioBackend_Priority
+{
+	AUDIOBACKEND_PRIORITY_SFX,
+	AUDIOBACKEND_PRIORITY_MUSIC
+} AudioBackend_Priority;
+
+// `frequency` and `period` (in frames) are requests which the backend may
+// not honour - 0 picks the default. AudioBackend_GetOutputFormat reports
+// what was actually obtained (0 if the backend doesn't mix in software).
+bool AudioBackend_Init(unsigned long frequency, size_t period);
 void AudioBackend_Deinit(void);
+void AudioBackend_GetOutputFormat(unsigned long *frequency, size_t *period);
 
 AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length);
+// Makes a sound that plays the same samples as `sound`, starting with its
+// frequency, volume and pan, but otherwise independent of it. The backend
+// shares the samples between the two sounds where it can.
+AudioBackend_Sound* AudioBackend_DuplicateSound(AudioBackend_Sound *sound);
+// Makes a sound whose samples are supplied by `callback` as it plays, and
+// mixed along with every other sound's. The callback is called with the
+// backend locked (see AudioBackend_Lock). Streams continue from where they
+// were stopped, ignore AudioBackend_RewindSound and the voice limit, and
+// are only supported by backends that mix in software (others return NULL).
+AudioBackend_Sound* AudioBackend_CreateStream(AudioBackend_StreamCallback callback, void *user_data);
 void AudioBackend_DestroySound(AudioBackend_Sound *sound);
 
 void AudioBackend_PlaySound(AudioBackend_Sound *sound, bool looping);
@@ -20,6 +44,33 @@ void AudioBackend_RewindSound(AudioBackend_Sound *sound);
 void AudioBackend_SetSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency);
 void AudioBackend_SetSoundVolume(AudioBackend_Sound *sound, long volume);
 void AudioBackend_SetSoundPan(AudioBackend_Sound *sound, long pan);
+void AudioBackend_SetSoundPriority(AudioBackend_Sound *sound, AudioBackend_Priority priority);
+
+// Sets a stream's volume as a linear 8.8 fixed-point scale, which, unlike
+// AudioBackend_SetSoundVolume, can go above 1.0 (the pan still applies)
+void AudioBackend_SetStreamVolume(AudioBackend_Sound *sound, unsigned short volume);
+// Fades a stream out logarithmically, after which it stays silent until
+// the fade is cancelled
+void AudioBackend_FadeOutStream(AudioBackend_Sound *sound, unsigned int milliseconds);
+void AudioBackend_CancelStreamFade(AudioBackend_Sound *sound);
+
+// When more than `voices` sounds would play at once (0 means no limit), the
+// least important one is cut off: lowest priority, then quietest, then oldest
+void AudioBackend_SetVoiceLimit(unsigned int voices);
+unsigned long AudioBackend_GetStolenVoiceCount(void);
+
+// Between AudioBackend_BeginBatch and AudioBackend_CommitBatch, the
+// AudioBackend_Batch* functions queue their changes instead of applying
+// them immediately. The queue is applied in order, under a single lock,
+// when the batch is committed. Only one thread may build a batch at a time.
+void AudioBackend_BeginBatch(void);
+void AudioBackend_CommitBatch(void);
+void AudioBackend_BatchPlaySound(AudioBackend_Sound *sound, bool looping);
+void AudioBackend_BatchStopSound(AudioBackend_Sound *sound);
+void AudioBackend_BatchRewindSound(AudioBackend_Sound *sound);
+void AudioBackend_BatchSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency);
+void AudioBackend_BatchSoundVolume(AudioBackend_Sound *sound, long volume);
+void AudioBackend_BatchSoundPan(AudioBackend_Sound *sound, long pan);
 
 void AudioBackend_SetOrganyaCallback(void (*callback)(void));
 void AudioBackend_SetOrganyaTimer(unsigned int milliseconds);
@@ -19,6 +19,7 @@
 typedef struct AudioBackend_Sound
 {
 	signed char *samples;
+	unsigned int *sample_references;	// Duplicated sounds share their samples, which are freed along with the last of them
 	ndspWaveBuf wave_buffer;
 	unsigned int frequency;
 	float volume;
@@ -95,8 +96,12 @@ static int AllocateChannel(AudioBackend_Sound *sound)
 	return -1;
 }
 
-bool AudioBackend_Init(void)
+bool AudioBackend_Init(unsigned long frequency, size_t period)
 {
+	// Mixing is done by the hardware, so there's nothing to configure
+	(void)frequency;
+	(void)period;
+
 	Result rc = ndspInit();
 
 	if (R_SUCCEEDED(rc))
@@ -133,39 +138,53 @@ void AudioBackend_Deinit(void)
 	ndspExit();
 }
 
-AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length)
+void AudioBackend_GetOutputFormat(unsigned long *frequency, size_t *period)
+{
+	*frequency = 0;
+	*period = 0;
+}
+
+static unsigned int identifier_allocator;
+
+static void InitSound(AudioBackend_Sound *sound, unsigned int frequency, size_t length)
 {
-	static unsigned int identifier_allocator;
+	memset(&sound->wave_buffer, 0, sizeof(sound->wave_buffer));
+	sound->wave_buffer.data_vaddr = sound->samples;
+	sound->wave_buffer.nsamples = length;
+
+	sound->frequency = frequency;
+	sound->volume = 1.0f;
+	sound->pan_l = 1.0f;
+	sound->pan_r = 1.0f;
+	sound->looping = false;
+
+	sound->channel = -1;
+
+	do
+	{
+		sound->identifier = ++identifier_allocator;
+	} while (sound->identifier == 0);	// 0 is reserved
+}
 
+AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length)
+{
 	AudioBackend_Sound *sound = (AudioBackend_Sound*)malloc(sizeof(AudioBackend_Sound));
 
 	if (sound != NULL)
 	{
 		sound->samples = (signed char*)linearAlloc(length);
+		sound->sample_references = (unsigned int*)malloc(sizeof(unsigned int));
 
-		if (sound->samples != NULL)
+		if (sound->samples != NULL && sound->sample_references != NULL)
 		{
 			for (size_t i = 0; i < length; ++i)
 				sound->samples[i] = samples[i] - 0x80;
 
 			DSP_FlushDataCache(sound->samples, length);
 
-			memset(&sound->wave_buffer, 0, sizeof(sound->wave_buffer));
-			sound->wave_buffer.data_vaddr = sound->samples;
-			sound->wave_buffer.nsamples = length;
-
-			sound->frequency = frequency;
-			sound->volume = 1.0f;
-			sound->pan_l = 1.0f;
-			sound->pan_r = 1.0f;
-			sound->looping = false;
-
-			sound->channel = -1;
+			*sound->sample_references = 1;
 
-			do
-			{
-				sound->identifier = ++identifier_allocator;
-			} while (sound->identifier == 0);	// 0 is reserved
+			InitSound(sound, frequency, length);
 
 			return sound;
 		}
@@ -174,6 +193,10 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 			Backend_PrintError("linearAlloc failed in AudioBackend_CreateSound");
 		}
 
+		if (sound->samples != NULL)
+			linearFree(sound->samples);
+
+		free(sound->sample_references);
 		free(sound);
 	}
 	else
@@ -184,6 +207,39 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 	return NULL;
 }
 
+AudioBackend_Sound* AudioBackend_DuplicateSound(AudioBackend_Sound *sound)
+{
+	AudioBackend_Sound *duplicate = (AudioBackend_Sound*)malloc(sizeof(AudioBackend_Sound));
+
+	if (duplicate != NULL)
+	{
+		duplicate->samples = sound->samples;
+		duplicate->sample_references = sound->sample_references;
+		++*duplicate->sample_references;
+
+		InitSound(duplicate, sound->frequency, sound->wave_buffer.nsamples);
+
+		duplicate->volume = sound->volume;
+		duplicate->pan_l = sound->pan_l;
+		duplicate->pan_r = sound->pan_r;
+	}
+	else
+	{
+		Backend_PrintError("malloc failed in AudioBackend_DuplicateSound");
+	}
+
+	return duplicate;
+}
+
+AudioBackend_Sound* AudioBackend_CreateStream(AudioBackend_StreamCallback callback, void *user_data)
+{
+	// Streams have to be mixed in software
+	(void)callback;
+	(void)user_data;
+
+	return NULL;
+}
+
 void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 {
 	if (sound->channel != -1 && channels[sound->channel].sound_identifier == sound->identifier)
@@ -193,7 +249,12 @@ void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 		channels[sound->channel].sound = NULL;
 	}
 
-	linearFree(sound->samples);
+	if (--*sound->sample_references == 0)
+	{
+		linearFree(sound->samples);
+		free(sound->sample_references);
+	}
+
 	free(sound);
 }
 
@@ -278,6 +339,80 @@ void AudioBackend_SetSoundPan(AudioBackend_Sound *sound, long pan)
 	}
 }
 
+void AudioBackend_SetSoundPriority(AudioBackend_Sound *sound, AudioBackend_Priority priority)
+{
+	// Voices are allocated by the hardware, so priorities aren't used
+	(void)sound;
+	(void)priority;
+}
+
+void AudioBackend_SetStreamVolume(AudioBackend_Sound *sound, unsigned short volume)
+{
+	(void)sound;
+	(void)volume;
+}
+
+void AudioBackend_FadeOutStream(AudioBackend_Sound *sound, unsigned int milliseconds)
+{
+	(void)sound;
+	(void)milliseconds;
+}
+
+void AudioBackend_CancelStreamFade(AudioBackend_Sound *sound)
+{
+	(void)sound;
+}
+
+void AudioBackend_SetVoiceLimit(unsigned int voices)
+{
+	(void)voices;
+}
+
+unsigned long AudioBackend_GetStolenVoiceCount(void)
+{
+	return 0;
+}
+
+void AudioBackend_BeginBatch(void)
+{
+	// This backend applies changes immediately, so there is nothing to queue
+}
+
+void AudioBackend_CommitBatch(void)
+{
+	
+}
+
+void AudioBackend_BatchPlaySound(AudioBackend_Sound *sound, bool looping)
+{
+	AudioBackend_PlaySound(sound, looping);
+}
+
+void AudioBackend_BatchStopSound(AudioBackend_Sound *sound)
+{
+	AudioBackend_StopSound(sound);
+}
+
+void AudioBackend_BatchRewindSound(AudioBackend_Sound *sound)
+{
+	AudioBackend_RewindSound(sound);
+}
+
+void AudioBackend_BatchSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency)
+{
+	AudioBackend_SetSoundFrequency(sound, frequency);
+}
+
+void AudioBackend_BatchSoundVolume(AudioBackend_Sound *sound, long volume)
+{
+	AudioBackend_SetSoundVolume(sound, volume);
+}
+
+void AudioBackend_BatchSoundPan(AudioBackend_Sound *sound, long pan)
+{
+	AudioBackend_SetSoundPan(sound, pan);
+}
+
 void AudioBackend_SetOrganyaCallback(void (*callback)(void))
 {
 	LightLock_Lock(&organya_mutex);
@@ -5,8 +5,11 @@
 
 #include <stddef.h>
 
-bool AudioBackend_Init(void)
+bool AudioBackend_Init(unsigned long frequency, size_t period)
 {
+	(void)frequency;
+	(void)period;
+
 	return true;
 }
 
@@ -15,6 +18,12 @@ void AudioBackend_Deinit(void)
 	
 }
 
+void AudioBackend_GetOutputFormat(unsigned long *frequency, size_t *period)
+{
+	*frequency = 0;
+	*period = 0;
+}
+
 AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length)
 {
 	(void)frequency;
@@ -24,6 +33,21 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 	return NULL;
 }
 
+AudioBackend_Sound* AudioBackend_DuplicateSound(AudioBackend_Sound *sound)
+{
+	(void)sound;
+
+	return NULL;
+}
+
+AudioBackend_Sound* AudioBackend_CreateStream(AudioBackend_StreamCallback callback, void *user_data)
+{
+	(void)callback;
+	(void)user_data;
+
+	return NULL;
+}
+
 void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 {
 	(void)sound;
@@ -63,6 +87,83 @@ void AudioBackend_SetSoundPan(AudioBackend_Sound *sound, long pan)
 	(void)pan;
 }
 
+void AudioBackend_SetSoundPriority(AudioBackend_Sound *sound, AudioBackend_Priority priority)
+{
+	(void)sound;
+	(void)priority;
+}
+
+void AudioBackend_SetStreamVolume(AudioBackend_Sound *sound, unsigned short volume)
+{
+	(void)sound;
+	(void)volume;
+}
+
+void AudioBackend_FadeOutStream(AudioBackend_Sound *sound, unsigned int milliseconds)
+{
+	(void)sound;
+	(void)milliseconds;
+}
+
+void AudioBackend_CancelStreamFade(AudioBackend_Sound *sound)
+{
+	(void)sound;
+}
+
+void AudioBackend_SetVoiceLimit(unsigned int voices)
+{
+	(void)voices;
+}
+
+unsigned long AudioBackend_GetStolenVoiceCount(void)
+{
+	return 0;
+}
+
+void AudioBackend_BeginBatch(void)
+{
+	
+}
+
+void AudioBackend_CommitBatch(void)
+{
+	
+}
+
+void AudioBackend_BatchPlaySound(AudioBackend_Sound *sound, bool looping)
+{
+	(void)sound;
+	(void)looping;
+}
+
+void AudioBackend_BatchStopSound(AudioBackend_Sound *sound)
+{
+	(void)sound;
+}
+
+void AudioBackend_BatchRewindSound(AudioBackend_Sound *sound)
+{
+	(void)sound;
+}
+
+void AudioBackend_BatchSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency)
+{
+	(void)sound;
+	(void)frequency;
+}
+
+void AudioBackend_BatchSoundVolume(AudioBackend_Sound *sound, long volume)
+{
+	(void)sound;
+	(void)volume;
+}
+
+void AudioBackend_BatchSoundPan(AudioBackend_Sound *sound, long pan)
+{
+	(void)sound;
+	(void)pan;
+}
+
 void AudioBackend_SetOrganyaCallback(void (*callback)(void))
 {
 	(void)callback;
@@ -4,30 +4,103 @@
 #include "../Audio.h"
 
 #include <stddef.h>
-
-#ifdef EXTRA_SOUND_FORMATS
-#include "../../ExtraSoundFormats.h"
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define SSE2_PACK
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+ #define NEON_PACK
 #endif
 
+#include "../Misc.h"
 #include "SoftwareMixer/Backend.h"
 #include "SoftwareMixer/Mixer.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define CLAMP(x, y, z) MIN(MAX((x), (y)), (z))
+
+typedef struct BatchCommand
+{
+	Mixer_Sound *sound;
+	Mixer_Command command;
+	long value;
+} BatchCommand;
 
 static unsigned long output_frequency;
+static size_t output_period;
+
+static BatchCommand batch_commands[0x100];
+static size_t total_batch_commands;
 
 static void (*organya_callback)(void);
 static unsigned int organya_callback_timer_master;
+static unsigned long organya_callback_timer;
+
+// While Organya is being updated from within the mixer, batches are
+// scheduled as timestamped commands instead of being applied immediately.
+static bool scheduling_commands;
+static int32_t *scheduling_stream;
+static size_t scheduling_frames_mixed; // How much of the stream has been mixed early, to free up space for more commands
+static size_t scheduling_current_frame;
+
+static void FlushBatch(void)
+{
+	if (scheduling_commands)
+	{
+		// The mixer mutex is already locked by MixSoundsAndUpdateOrganya
+		for (size_t i = 0; i < total_batch_commands; ++i)
+		{
+			const BatchCommand *command = &batch_commands[i];
+
+			if (!Mixer_ScheduleCommand(command->sound, command->command, command->value, scheduling_current_frame - scheduling_frames_mixed))
+			{
+				// Out of room: mix everything before this command so that its queue is freed
+				Mixer_MixSounds(scheduling_stream + scheduling_frames_mixed * 2, scheduling_current_frame - scheduling_frames_mixed);
+				scheduling_frames_mixed = scheduling_current_frame;
+
+				Mixer_ScheduleCommand(command->sound, command->command, command->value, 0);
+			}
+		}
+	}
+	else
+	{
+		SoftwareMixerBackend_LockMixerMutex();
+
+		for (size_t i = 0; i < total_batch_commands; ++i)
+			Mixer_ExecuteCommand(batch_commands[i].sound, batch_commands[i].command, batch_commands[i].value);
+
+		SoftwareMixerBackend_UnlockMixerMutex();
+	}
+
+	total_batch_commands = 0;
+}
 
-static void MixSoundsAndUpdateOrganya(long *stream, size_t frames_total)
+static void QueueBatchCommand(AudioBackend_Sound *sound, Mixer_Command command, long value)
+{
+	if (sound == NULL)
+		return;
+
+	// Rather than fail, apply what we have so far and start over
+	if (total_batch_commands == sizeof(batch_commands) / sizeof(batch_commands[0]))
+		FlushBatch();
+
+	BatchCommand *batch_command = &batch_commands[total_batch_commands++];
+	batch_command->sound = (Mixer_Sound*)sound;
+	batch_command->command = command;
+	batch_command->value = value;
+}
+
+static void MixSoundsAndUpdateOrganya(int32_t *stream, size_t frames_total)
 {
 	SoftwareMixerBackend_LockOrganyaMutex();
+	SoftwareMixerBackend_LockMixerMutex();
 
 	if (organya_callback_timer_master == 0)
 	{
-		SoftwareMixerBackend_LockMixerMutex();
 		Mixer_MixSounds(stream, frames_total);
-		SoftwareMixerBackend_UnlockMixerMutex();
 	}
 	else
 	{
@@ -35,46 +108,97 @@ static void MixSoundsAndUpdateOrganya(long *stream, size_t frames_total)
 		// In the original game, Organya ran asynchronously in a separate thread,
 		// firing off commands to DirectSound in realtime. To match that, we'd
 		// need a very low-latency buffer, otherwise we'd get mistimed instruments.
-		// Instead, we can just do this.
-		unsigned int frames_done = 0;
-
-		while (frames_done != frames_total)
+		// Instead, we run Organya for the whole buffer up-front, and have the
+		// mixer apply its commands at the exact frames they were issued on.
+		scheduling_commands = true;
+		scheduling_stream = stream;
+		scheduling_frames_mixed = 0;
+		scheduling_current_frame = 0;
+
+		while (scheduling_current_frame != frames_total)
 		{
-			static unsigned long organya_callback_timer;
-
 			if (organya_callback_timer == 0)
 			{
 				organya_callback_timer = organya_callback_timer_master;
 				organya_callback();
 			}
 
-			const unsigned int frames_to_do = MIN(organya_callback_timer, frames_total - frames_done);
-
-			SoftwareMixerBackend_LockMixerMutex();
-			Mixer_MixSounds(stream + frames_done * 2, frames_to_do);
-			SoftwareMixerBackend_UnlockMixerMutex();
+			const unsigned int frames_to_do = MIN(organya_callback_timer, frames_total - scheduling_current_frame);
 
-			frames_done += frames_to_do;
+			scheduling_current_frame += frames_to_do;
 			organya_callback_timer -= frames_to_do;
 		}
+
+		scheduling_commands = false;
+
+		Mixer_MixSounds(stream + scheduling_frames_mixed * 2, frames_total - scheduling_frames_mixed);
 	}
 
+	SoftwareMixerBackend_UnlockMixerMutex();
 	SoftwareMixerBackend_UnlockOrganyaMutex();
+}
 
-#ifdef EXTRA_SOUND_FORMATS
-	ExtraSound_Mix(stream, frames_total);
+// Clamps the mix to -0x7FFF to 0x7FFF, and converts it to S16
+static void ConvertToS16(const int32_t *input, short *output, size_t samples)
+{
+	size_t i = 0;
+
+	// Saturating packs clamp to -0x8000, so the result still needs clamping to -0x7FFF
+#if defined(SSE2_PACK)
+	const __m128i minimum = _mm_set1_epi16(-0x7FFF);
+
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m128i low = _mm_loadu_si128((const __m128i*)&input[i]);
+		const __m128i high = _mm_loadu_si128((const __m128i*)&input[i + 4]);
+
+		_mm_storeu_si128((__m128i*)&output[i], _mm_max_epi16(_mm_packs_epi32(low, high), minimum));
+	}
+#elif defined(NEON_PACK)
+	const int16x8_t minimum = vdupq_n_s16(-0x7FFF);
+
+	for (; i + 8 <= samples; i += 8)
+	{
+		const int16x4_t low = vqmovn_s32(vld1q_s32(&input[i]));
+		const int16x4_t high = vqmovn_s32(vld1q_s32(&input[i + 4]));
+
+		vst1q_s16(&output[i], vmaxq_s16(vcombine_s16(low, high), minimum));
+	}
 #endif
+
+	for (; i < samples; ++i)
+		output[i] = (short)CLAMP(input[i], -0x7FFF, 0x7FFF);
 }
 
-bool AudioBackend_Init(void)
+// Called by the device backend whenever it needs more audio
+static void Callback(short *stream, size_t frames_total)
 {
-	output_frequency = SoftwareMixerBackend_Init(MixSoundsAndUpdateOrganya);
+	size_t frames_done = 0;
+
+	while (frames_done != frames_total)
+	{
+		int32_t mix_buffer[0x800 * 2];	// 2 because stereo
+
+		const size_t subframes = MIN(0x800, frames_total - frames_done);
+
+		MixSoundsAndUpdateOrganya(mix_buffer, subframes);
+
+		ConvertToS16(mix_buffer, stream + frames_done * 2, subframes * 2);
+
+		frames_done += subframes;
+	}
+}
+
+bool AudioBackend_Init(unsigned long frequency, size_t period)
+{
+	output_period = period;
+	output_frequency = SoftwareMixerBackend_Init(Callback, frequency, &output_period);
+
+	organya_callback_timer = 0;
 
 	if (output_frequency != 0)
 	{
-	#ifdef EXTRA_SOUND_FORMATS
-		ExtraSound_Init(output_frequency);
-	#endif
+		Backend_PrintInfo("Audio output: %luHz, %lu-frame period", output_frequency, (unsigned long)output_period);
 
 		Mixer_Init(output_frequency);
 
@@ -82,10 +206,6 @@ bool AudioBackend_Init(void)
 			return true;
 
 		SoftwareMixerBackend_Deinit();
-
-	#ifdef EXTRA_SOUND_FORMATS
-		ExtraSound_Deinit();
-	#endif
 	}
 
 	return false;
@@ -94,10 +214,12 @@ bool AudioBackend_Init(void)
 void AudioBackend_Deinit(void)
 {
 	SoftwareMixerBackend_Deinit();
+}
 
-#ifdef EXTRA_SOUND_FORMATS
-	ExtraSound_Deinit();
-#endif
+void AudioBackend_GetOutputFormat(unsigned long *frequency, size_t *period)
+{
+	*frequency = output_frequency;
+	*period = output_period;
 }
 
 AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length)
@@ -111,6 +233,31 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 	return (AudioBackend_Sound*)sound;
 }
 
+AudioBackend_Sound* AudioBackend_DuplicateSound(AudioBackend_Sound *sound)
+{
+	if (sound == NULL)
+		return NULL;
+
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_Sound *duplicate = Mixer_DuplicateSound((Mixer_Sound*)sound);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+
+	return (AudioBackend_Sound*)duplicate;
+}
+
+AudioBackend_Sound* AudioBackend_CreateStream(AudioBackend_StreamCallback callback, void *user_data)
+{
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_Sound *sound = Mixer_CreateStream(callback, user_data);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+
+	return (AudioBackend_Sound*)sound;
+}
+
 void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 {
 	if (sound == NULL)
@@ -195,6 +342,115 @@ void AudioBackend_SetSoundPan(AudioBackend_Sound *sound, long pan)
 	SoftwareMixerBackend_UnlockMixerMutex();
 }
 
+void AudioBackend_SetSoundPriority(AudioBackend_Sound *sound, AudioBackend_Priority priority)
+{
+	if (sound == NULL)
+		return;
+
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_SetSoundPriority((Mixer_Sound*)sound, priority == AUDIOBACKEND_PRIORITY_MUSIC ? MIXER_PRIORITY_MUSIC : MIXER_PRIORITY_SFX);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+}
+
+void AudioBackend_SetStreamVolume(AudioBackend_Sound *sound, unsigned short volume)
+{
+	if (sound == NULL)
+		return;
+
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_SetStreamVolume((Mixer_Sound*)sound, volume);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+}
+
+void AudioBackend_FadeOutStream(AudioBackend_Sound *sound, unsigned int milliseconds)
+{
+	if (sound == NULL)
+		return;
+
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_FadeOutStream((Mixer_Sound*)sound, milliseconds);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+}
+
+void AudioBackend_CancelStreamFade(AudioBackend_Sound *sound)
+{
+	if (sound == NULL)
+		return;
+
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_CancelStreamFade((Mixer_Sound*)sound);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+}
+
+void AudioBackend_SetVoiceLimit(unsigned int voices)
+{
+	SoftwareMixerBackend_LockMixerMutex();
+
+	Mixer_SetVoiceLimit(voices);
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+}
+
+unsigned long AudioBackend_GetStolenVoiceCount(void)
+{
+	SoftwareMixerBackend_LockMixerMutex();
+
+	const unsigned long stolen_voices = Mixer_GetStolenVoiceCount();
+
+	SoftwareMixerBackend_UnlockMixerMutex();
+
+	return stolen_voices;
+}
+
+void AudioBackend_BeginBatch(void)
+{
+	total_batch_commands = 0;
+}
+
+void AudioBackend_CommitBatch(void)
+{
+	if (total_batch_commands != 0)
+		FlushBatch();
+}
+
+void AudioBackend_BatchPlaySound(AudioBackend_Sound *sound, bool looping)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_PLAY, looping);
+}
+
+void AudioBackend_BatchStopSound(AudioBackend_Sound *sound)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_STOP, 0);
+}
+
+void AudioBackend_BatchRewindSound(AudioBackend_Sound *sound)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_REWIND, 0);
+}
+
+void AudioBackend_BatchSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_FREQUENCY, frequency);
+}
+
+void AudioBackend_BatchSoundVolume(AudioBackend_Sound *sound, long volume)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_VOLUME, volume);
+}
+
+void AudioBackend_BatchSoundPan(AudioBackend_Sound *sound, long pan)
+{
+	QueueBatchCommand(sound, MIXER_COMMAND_PAN, pan);
+}
+
 void AudioBackend_SetOrganyaCallback(void (*callback)(void))
 {
 	SoftwareMixerBackend_LockOrganyaMutex();
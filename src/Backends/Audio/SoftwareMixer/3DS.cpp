@@ -11,15 +11,16 @@
 #include "../../Misc.h"
 
 #define SAMPLE_RATE 32000       // The native sample rate is 32728.4980469
-#define FRAMES_PER_BUFFER (SAMPLE_RATE / 30) // 33.333 milliseconds
+#define DEFAULT_FRAMES_PER_BUFFER (SAMPLE_RATE / 30) // 33.333 milliseconds
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define CLAMP(a, min, max) MIN(MAX((a), (min)), (max))
 
-static void (*parent_callback)(long *stream, size_t frames_total);
+static void (*parent_callback)(short *stream, size_t frames_total);
 
 static short *stream_buffer;
+static size_t frames_per_buffer;
 
 static ndspWaveBuf dsp_buffers[2];
 static bool current_dsp_buffer;
@@ -34,30 +35,7 @@ static bool audio_thread_die;
 
 static void FillBuffer(short *stream, size_t frames_total)
 {
-	size_t frames_done = 0;
-
-	while (frames_done != frames_total)
-	{
-		long mix_buffer[FRAMES_PER_BUFFER * 2];	// 2 because stereo
-
-		size_t subframes = MIN(FRAMES_PER_BUFFER, frames_total - frames_done);
-
-		memset(mix_buffer, 0, subframes * sizeof(long) * 2);
-
-		parent_callback(mix_buffer, subframes);
-
-		for (size_t i = 0; i < subframes * 2; ++i)
-		{
-			if (mix_buffer[i] > 0x7FFF)
-				*stream++ = 0x7FFF;
-			else if (mix_buffer[i] < -0x7FFF)
-				*stream++ = -0x7FFF;
-			else
-				*stream++ = mix_buffer[i];
-		}
-
-		frames_done += subframes;
-	}
+	parent_callback(stream, frames_total);
 
 	DSP_FlushDataCache(stream, frames_total * sizeof(short) * 2);
 }
@@ -88,13 +66,18 @@ static void AudioThread(void *user_data)
 	}
 }
 
-unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t frames_total))
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period)
 {
 	parent_callback = callback;
 
+	(void)frequency;	// The DSP is always driven at SAMPLE_RATE
+
+	frames_per_buffer = *period != 0 ? *period : DEFAULT_FRAMES_PER_BUFFER;
+	*period = frames_per_buffer;
+
 	current_dsp_buffer = false;
 
-	stream_buffer = (short*)linearAlloc(FRAMES_PER_BUFFER * sizeof(short) * 2 * 2);
+	stream_buffer = (short*)linearAlloc(frames_per_buffer * sizeof(short) * 2 * 2);
 
 	if (stream_buffer != NULL)
 	{
@@ -126,10 +109,10 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 			ndspChnSetMix(0, mix);
 
 			memset(dsp_buffers, 0, sizeof(dsp_buffers));
-			dsp_buffers[0].data_vaddr = &stream_buffer[FRAMES_PER_BUFFER * 2 * 0];
-			dsp_buffers[0].nsamples = FRAMES_PER_BUFFER;
-			dsp_buffers[1].data_vaddr = &stream_buffer[FRAMES_PER_BUFFER * 2 * 1];
-			dsp_buffers[1].nsamples = FRAMES_PER_BUFFER;
+			dsp_buffers[0].data_vaddr = &stream_buffer[frames_per_buffer * 2 * 0];
+			dsp_buffers[0].nsamples = frames_per_buffer;
+			dsp_buffers[1].data_vaddr = &stream_buffer[frames_per_buffer * 2 * 1];
+			dsp_buffers[1].nsamples = frames_per_buffer;
 
 			LightLock_Init(&mixer_mutex);
 			LightLock_Init(&organya_mutex);
@@ -181,7 +164,7 @@ void SoftwareMixerBackend_Deinit(void)
 
 bool SoftwareMixerBackend_Start(void)
 {
-	FillBuffer(stream_buffer, FRAMES_PER_BUFFER * 2);
+	FillBuffer(stream_buffer, frames_per_buffer * 2);
 
 	ndspChnWaveBufAdd(0, &dsp_buffers[0]);
 	ndspChnWaveBufAdd(0, &dsp_buffers[1]);
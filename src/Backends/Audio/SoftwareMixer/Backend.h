@@ -5,7 +5,10 @@
 
 #include <stddef.h>
 
-unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t frames_total));
+// `frequency` and `*period` (in frames) are only requests - 0 picks the backend's default.
+// Returns the frequency actually used, and writes the actual period to `*period`.
+// `callback` fills `stream` with `frames_total` frames of interlaced stereo S16 PCM.
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period);
 void SoftwareMixerBackend_Deinit(void);
 
 bool SoftwareMixerBackend_Start(void);
@@ -4,11 +4,34 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct Mixer_Sound Mixer_Sound;
 
+// Supplies a stream's next `frames` frames of 16-bit stereo at the output frequency.
+// Returns how many it supplied: fewer than `frames` means that the stream has ended.
+typedef size_t (*Mixer_StreamCallback)(void *user_data, short *buffer, size_t frames);
+
+typedef enum Mixer_Priority
+{
+	MIXER_PRIORITY_SFX,
+	MIXER_PRIORITY_MUSIC
+} Mixer_Priority;
+
+typedef enum Mixer_Command
+{
+	MIXER_COMMAND_PLAY,
+	MIXER_COMMAND_STOP,
+	MIXER_COMMAND_REWIND,
+	MIXER_COMMAND_FREQUENCY,
+	MIXER_COMMAND_VOLUME,
+	MIXER_COMMAND_PAN
+} Mixer_Command;
+
 void Mixer_Init(unsigned long frequency);
 Mixer_Sound* Mixer_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length);
+Mixer_Sound* Mixer_DuplicateSound(Mixer_Sound *original);
+Mixer_Sound* Mixer_CreateStream(Mixer_StreamCallback callback, void *user_data);
 void Mixer_DestroySound(Mixer_Sound *sound);
 void Mixer_PlaySound(Mixer_Sound *sound, bool looping);
 void Mixer_StopSound(Mixer_Sound *sound);
@@ -16,4 +39,20 @@ void Mixer_RewindSound(Mixer_Sound *sound);
 void Mixer_SetSoundFrequency(Mixer_Sound *sound, unsigned int frequency);
 void Mixer_SetSoundVolume(Mixer_Sound *sound, long volume);
 void Mixer_SetSoundPan(Mixer_Sound *sound, long pan);
-void Mixer_MixSounds(long *stream, size_t frames_total);
+void Mixer_SetSoundPriority(Mixer_Sound *sound, Mixer_Priority priority);
+void Mixer_SetStreamVolume(Mixer_Sound *sound, unsigned short volume);
+void Mixer_FadeOutStream(Mixer_Sound *sound, unsigned int milliseconds);
+void Mixer_CancelStreamFade(Mixer_Sound *sound);
+void Mixer_SetVoiceLimit(unsigned int voices);
+unsigned long Mixer_GetStolenVoiceCount(void);
+uint64_t Mixer_GetVoiceFramesMixed(void);
+void Mixer_ExecuteCommand(Mixer_Sound *sound, Mixer_Command command, long value);
+bool Mixer_ScheduleCommand(Mixer_Sound *sound, Mixer_Command command, long value, size_t frame);
+
+// Mixes every playing sound into `stream`, overwriting its previous contents.
+//
+// Headroom: each sound contributes at most 128 * 256 = 2^15 per sample
+// (a signed 8-bit sample scaled by an 8.8 volume of at most 1.0), and
+// ExtraSound streams add at most around 2^16 each, so a 32-bit accumulator
+// can't overflow with fewer than tens of thousands of voices.
+void Mixer_MixSounds(int32_t *stream, size_t frames_total);
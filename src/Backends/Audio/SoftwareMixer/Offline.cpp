@@ -0,0 +1,59 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// A backend without an audio device, for rendering audio faster than realtime.
+// Rather than a device pulling audio from the mixer whenever it needs it, the
+// program pulls it itself with SoftwareMixerBackend_Render. Everything happens
+// on one thread, so the mutexes aren't needed.
+
+#include "Backend.h"
+#include "Offline.h"
+
+#include <stddef.h>
+
+static void (*parent_callback)(short *stream, size_t frames_total);
+
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period)
+{
+	parent_callback = callback;
+
+	if (*period == 0)
+		*period = 0x400;
+
+	return frequency != 0 ? frequency : 48000;
+}
+
+void SoftwareMixerBackend_Deinit(void)
+{
+	parent_callback = NULL;
+}
+
+bool SoftwareMixerBackend_Start(void)
+{
+	return true;
+}
+
+void SoftwareMixerBackend_LockMixerMutex(void)
+{
+	
+}
+
+void SoftwareMixerBackend_UnlockMixerMutex(void)
+{
+	
+}
+
+void SoftwareMixerBackend_LockOrganyaMutex(void)
+{
+	
+}
+
+void SoftwareMixerBackend_UnlockOrganyaMutex(void)
+{
+	
+}
+
+void SoftwareMixerBackend_Render(short *stream, size_t frames_total)
+{
+	parent_callback(stream, frames_total);
+}
@@ -0,0 +1,9 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include <stddef.h>
+
+// Fills `stream` with `frames_total` frames of interlaced stereo S16 PCM, as an audio device would
+void SoftwareMixerBackend_Render(short *stream, size_t frames_total);
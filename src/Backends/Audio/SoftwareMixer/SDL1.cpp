@@ -4,51 +4,22 @@
 #include "Backend.h"
 
 #include <stddef.h>
-#include <string.h>
 #include <string>
 
 #include "SDL.h"
 
 #include "../../Misc.h"
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-
-static void (*parent_callback)(long *stream, size_t frames_total);
+static void (*parent_callback)(short *stream, size_t frames_total);
 
 static void Callback(void *user_data, Uint8 *stream_uint8, int len)
 {
 	(void)user_data;
 
-	short *stream = (short*)stream_uint8;
-	const size_t frames_total = len / sizeof(short) / 2;
-
-	size_t frames_done = 0;
-
-	while (frames_done != frames_total)
-	{
-		long mix_buffer[0x800 * 2];	// 2 because stereo
-
-		size_t subframes = MIN(0x800, frames_total - frames_done);
-
-		memset(mix_buffer, 0, subframes * sizeof(long) * 2);
-
-		parent_callback(mix_buffer, subframes);
-
-		for (size_t i = 0; i < subframes * 2; ++i)
-		{
-			if (mix_buffer[i] > 0x7FFF)
-				*stream++ = 0x7FFF;
-			else if (mix_buffer[i] < -0x7FFF)
-				*stream++ = -0x7FFF;
-			else
-				*stream++ = mix_buffer[i];
-		}
-
-		frames_done += subframes;
-	}
+	parent_callback((short*)stream_uint8, len / sizeof(short) / 2);
 }
 
-unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t frames_total))
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period)
 {
 	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
 	{
@@ -58,10 +29,10 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 	}
 
 	SDL_AudioSpec specification;
-	specification.freq = 48000;
+	specification.freq = frequency != 0 ? frequency : 48000;
 	specification.format = AUDIO_S16;
 	specification.channels = 2;
-	specification.samples = 0x400;	// Roughly 10 milliseconds for 48000Hz
+	specification.samples = *period != 0 ? *period : 0x400;	// Roughly 10 milliseconds for 48000Hz
 	specification.callback = Callback;
 	specification.userdata = NULL;
 
@@ -78,6 +49,8 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 
 	parent_callback = callback;
 
+	*period = obtained_specification.samples;
+
 	return obtained_specification.freq;
 }
 
@@ -21,7 +21,7 @@
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define CLAMP(x, y, z) MIN(MAX((x), (y)), (z))
 
-static void (*parent_callback)(long *stream, size_t frames_total);
+static void (*parent_callback)(short *stream, size_t frames_total);
 
 static OSMutex sound_list_mutex;
 static OSMutex organya_mutex;
@@ -29,7 +29,7 @@ static OSMutex organya_mutex;
 static AXVoice *voices[2];
 
 static short *stream_buffers[2];
-static long *stream_buffer_long;
+static short *stream_buffer_interlaced;
 static size_t buffer_length;
 
 static void FrameCallback(void)
@@ -47,39 +47,21 @@ static void FrameCallback(void)
 
 	if (current_buffer != last_buffer)
 	{
-		// Clear the mixer buffer
-		memset(stream_buffer_long, 0, buffer_length * sizeof(long) * 2);
-
 		// Fill mixer buffer
-		parent_callback(stream_buffer_long, buffer_length);
+		parent_callback(stream_buffer_interlaced, buffer_length);
 
-		// Deinterlate samples, convert them to S16, and write them to the double-buffers
+		// Deinterlace samples, and write them to the double-buffers
 		short *left_output_buffer = &stream_buffers[0][buffer_length * last_buffer];
 		short *right_output_buffer = &stream_buffers[1][buffer_length * last_buffer];
 
-		long *mixer_buffer_pointer = stream_buffer_long;
+		short *mixer_buffer_pointer = stream_buffer_interlaced;
 		short *left_output_buffer_pointer = left_output_buffer;
 		short *right_output_buffer_pointer = right_output_buffer;
 
 		for (unsigned int i = 0; i < buffer_length; ++i)
 		{
-			const long left_sample = *mixer_buffer_pointer++;
-			const long right_sample = *mixer_buffer_pointer++;
-
-			// Clamp samples to sane limits, convert to S16, and store in double-buffers
-			if (left_sample > 0x7FFF)
-				*left_output_buffer_pointer++ = 0x7FFF;
-			else if (left_sample < -0x7FFF)
-				*left_output_buffer_pointer++ = -0x7FFF;
-			else
-				*left_output_buffer_pointer++ = (short)left_sample;
-
-			if (right_sample > 0x7FFF)
-				*right_output_buffer_pointer++ = 0x7FFF;
-			else if (right_sample < -0x7FFF)
-				*right_output_buffer_pointer++ = -0x7FFF;
-			else
-				*right_output_buffer_pointer++ = (short)right_sample;
+			*left_output_buffer_pointer++ = *mixer_buffer_pointer++;
+			*right_output_buffer_pointer++ = *mixer_buffer_pointer++;
 		}
 
 		// Make sure the sound hardware can see our data
@@ -90,7 +72,7 @@ static void FrameCallback(void)
 	}
 }
 
-unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t frames_total))
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period)
 {
 	if (!AXIsInit())
 	{
@@ -105,18 +87,25 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 	OSInitMutex(&sound_list_mutex);
 	OSInitMutex(&organya_mutex);
 
+	(void)frequency;	// The renderer's frequency is fixed
+
 	unsigned long output_frequency = AXGetInputSamplesPerSec();
 
-	buffer_length = output_frequency / 100;	// 10ms buffer
+	// The frame callback fires every 3ms, so the buffer can't be shorter than that
+	if (*period == 0)
+		buffer_length = output_frequency / 100;	// 10ms buffer
+	else
+		buffer_length = MAX(*period, output_frequency * 3 / 1000);
+
+	*period = buffer_length;
 
 	// Create and initialise two 'voices': each one will stream its own
 	// audio - one for the left speaker, and one for the right. 
 
-	// The software-mixer outputs interlaced samples into a buffer of `long`s,
-	// so create a buffer for it here.
-	stream_buffer_long = (long*)malloc(buffer_length * sizeof(long) * 2);	// `* 2` because it's an interlaced stereo buffer
+	// The software-mixer outputs interlaced samples, so create a buffer for it here.
+	stream_buffer_interlaced = (short*)malloc(buffer_length * sizeof(short) * 2);	// `* 2` because it's an interlaced stereo buffer
 
-	if (stream_buffer_long != NULL)
+	if (stream_buffer_interlaced != NULL)
 	{
 		stream_buffers[0] = (short*)malloc(buffer_length * sizeof(short) * AUDIO_BUFFERS);
 
@@ -185,7 +174,7 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 			free(stream_buffers[0]);
 		}
 
-		free(stream_buffer_long);
+		free(stream_buffer_interlaced);
 	}
 
 	AXQuit();
@@ -203,7 +192,7 @@ void SoftwareMixerBackend_Deinit(void)
 	free(stream_buffers[1]);
 	free(stream_buffers[0]);
 
-	free(stream_buffer_long);
+	free(stream_buffer_interlaced);
 
 	AXQuit();
 }
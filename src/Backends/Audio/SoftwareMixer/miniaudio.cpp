@@ -4,7 +4,6 @@
 #include "Backend.h"
 
 #include <stddef.h>
-#include <string.h>
 
 #define MINIAUDIO_IMPLEMENTATION
 #define MA_NO_DECODING
@@ -17,9 +16,7 @@
 
 #include "../../Misc.h"
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-
-static void (*parent_callback)(long *stream, size_t frames_total);
+static void (*parent_callback)(short *stream, size_t frames_total);
 
 static ma_context context;
 static ma_device device;
@@ -31,41 +28,17 @@ static void Callback(ma_device *device, void *output_stream, const void *input_s
 	(void)device;
 	(void)input_stream;
 
-	short *stream = (short*)output_stream;
-
-	size_t frames_done = 0;
-
-	while (frames_done != frames_total)
-	{
-		long mix_buffer[0x800 * 2];	// 2 because stereo
-
-		size_t subframes = MIN(0x800, frames_total - frames_done);
-
-		memset(mix_buffer, 0, subframes * sizeof(long) * 2);
-
-		parent_callback(mix_buffer, subframes);
-
-		for (size_t i = 0; i < subframes * 2; ++i)
-		{
-			if (mix_buffer[i] > 0x7FFF)
-				*stream++ = 0x7FFF;
-			else if (mix_buffer[i] < -0x7FFF)
-				*stream++ = -0x7FFF;
-			else
-				*stream++ = mix_buffer[i];
-		}
-
-		frames_done += subframes;
-	}
+	parent_callback((short*)output_stream, frames_total);
 }
 
-unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t frames_total))
+unsigned long SoftwareMixerBackend_Init(void (*callback)(short *stream, size_t frames_total), unsigned long frequency, size_t *period)
 {
 	ma_device_config config = ma_device_config_init(ma_device_type_playback);
 	config.playback.pDeviceID = NULL;
 	config.playback.format = ma_format_s16;
 	config.playback.channels = 2;
-	config.sampleRate = 0;	// Let miniaudio decide what sample rate to use
+	config.sampleRate = frequency;	// If this is 0, miniaudio decides what sample rate to use
+	config.periodSizeInFrames = *period;	// Likewise
 	config.dataCallback = Callback;
 	config.pUserData = NULL;
 
@@ -89,6 +62,8 @@ unsigned long SoftwareMixerBackend_Init(void (*callback)(long *stream, size_t fr
 				{
 					parent_callback = callback;
 
+					*period = device.playback.internalPeriodSizeInFrames;
+
 					return device.sampleRate;
 				}
 				else
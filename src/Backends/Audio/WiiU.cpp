@@ -27,6 +27,7 @@
 struct AudioBackend_Sound
 {
 	signed char *samples;
+	unsigned int *sample_references;	// Duplicated sounds share their samples, which are freed along with the last of them
 	size_t length;
 	AXVoice *voice;
 	unsigned int frequency;
@@ -136,8 +137,12 @@ static int ThreadFunction(int argc, const char *argv[])
 	return 0;
 }
 
-bool AudioBackend_Init(void)
+bool AudioBackend_Init(unsigned long frequency, size_t period)
 {
+	// Mixing is done by the hardware, so there's nothing to configure
+	(void)frequency;
+	(void)period;
+
 	if (!AXIsInit())
 	{
 		AXInitParams initparams = {
@@ -167,6 +172,12 @@ void AudioBackend_Deinit(void)
 	AXQuit();
 }
 
+void AudioBackend_GetOutputFormat(unsigned long *frequency, size_t *period)
+{
+	*frequency = 0;
+	*period = 0;
+}
+
 AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsigned char *samples, size_t length)
 {
 	AudioBackend_Sound *sound = (AudioBackend_Sound*)malloc(sizeof(AudioBackend_Sound));
@@ -174,8 +185,9 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 	if (sound != NULL)
 	{
 		signed char *samples_copy = (signed char*)malloc(length);
+		unsigned int *sample_references = (unsigned int*)malloc(sizeof(unsigned int));
 
-		if (samples_copy != NULL)
+		if (samples_copy != NULL && sample_references != NULL)
 		{
 			// Convert to signed
 			for (size_t i = 0; i < length; ++i)
@@ -183,7 +195,10 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 
 			DCStoreRange(samples_copy, length);
 
+			*sample_references = 1;
+
 			sound->samples = samples_copy;
+			sound->sample_references = sample_references;
 			sound->length = length;
 			sound->voice = NULL;
 			sound->frequency = frequency;
@@ -199,12 +214,51 @@ AudioBackend_Sound* AudioBackend_CreateSound(unsigned int frequency, const unsig
 			return sound;
 		}
 
+		free(samples_copy);
+		free(sample_references);
 		free(sound);
 	}
 
 	return NULL;
 }
 
+AudioBackend_Sound* AudioBackend_DuplicateSound(AudioBackend_Sound *sound)
+{
+	if (sound == NULL)
+		return NULL;
+
+	AudioBackend_Sound *duplicate = (AudioBackend_Sound*)malloc(sizeof(AudioBackend_Sound));
+
+	if (duplicate != NULL)
+	{
+		duplicate->samples = sound->samples;
+		duplicate->sample_references = sound->sample_references;
+		++*duplicate->sample_references;
+		duplicate->length = sound->length;
+		duplicate->voice = NULL;
+		duplicate->frequency = sound->frequency;
+		duplicate->volume = sound->volume;
+		duplicate->pan_l = sound->pan_l;
+		duplicate->pan_r = sound->pan_r;
+
+		OSLockMutex(&sound_list_mutex);
+		duplicate->next = sound_list_head;
+		sound_list_head = duplicate;
+		OSUnlockMutex(&sound_list_mutex);
+	}
+
+	return duplicate;
+}
+
+AudioBackend_Sound* AudioBackend_CreateStream(AudioBackend_StreamCallback callback, void *user_data)
+{
+	// Streams have to be mixed in software
+	(void)callback;
+	(void)user_data;
+
+	return NULL;
+}
+
 void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 {
 	if (sound == NULL)
@@ -231,7 +285,12 @@ void AudioBackend_DestroySound(AudioBackend_Sound *sound)
 		AXVoiceEnd(sound->voice);
 	}
 
-	free(sound->samples);
+	if (--*sound->sample_references == 0)
+	{
+		free(sound->samples);
+		free(sound->sample_references);
+	}
+
 	free(sound);
 }
 
@@ -408,6 +467,80 @@ void AudioBackend_SetSoundPan(AudioBackend_Sound *sound, long pan)
 	OSUnlockMutex(&sound_list_mutex);
 }
 
+void AudioBackend_SetSoundPriority(AudioBackend_Sound *sound, AudioBackend_Priority priority)
+{
+	// Voices are allocated by the hardware, so priorities aren't used
+	(void)sound;
+	(void)priority;
+}
+
+void AudioBackend_SetStreamVolume(AudioBackend_Sound *sound, unsigned short volume)
+{
+	(void)sound;
+	(void)volume;
+}
+
+void AudioBackend_FadeOutStream(AudioBackend_Sound *sound, unsigned int milliseconds)
+{
+	(void)sound;
+	(void)milliseconds;
+}
+
+void AudioBackend_CancelStreamFade(AudioBackend_Sound *sound)
+{
+	(void)sound;
+}
+
+void AudioBackend_SetVoiceLimit(unsigned int voices)
+{
+	(void)voices;
+}
+
+unsigned long AudioBackend_GetStolenVoiceCount(void)
+{
+	return 0;
+}
+
+void AudioBackend_BeginBatch(void)
+{
+	// This backend applies changes immediately, so there is nothing to queue
+}
+
+void AudioBackend_CommitBatch(void)
+{
+	
+}
+
+void AudioBackend_BatchPlaySound(AudioBackend_Sound *sound, bool looping)
+{
+	AudioBackend_PlaySound(sound, looping);
+}
+
+void AudioBackend_BatchStopSound(AudioBackend_Sound *sound)
+{
+	AudioBackend_StopSound(sound);
+}
+
+void AudioBackend_BatchRewindSound(AudioBackend_Sound *sound)
+{
+	AudioBackend_RewindSound(sound);
+}
+
+void AudioBackend_BatchSoundFrequency(AudioBackend_Sound *sound, unsigned int frequency)
+{
+	AudioBackend_SetSoundFrequency(sound, frequency);
+}
+
+void AudioBackend_BatchSoundVolume(AudioBackend_Sound *sound, long volume)
+{
+	AudioBackend_SetSoundVolume(sound, volume);
+}
+
+void AudioBackend_BatchSoundPan(AudioBackend_Sound *sound, long pan)
+{
+	AudioBackend_SetSoundPan(sound, pan);
+}
+
 void AudioBackend_SetOrganyaCallback(void (*callback)(void))
 {
 	// As far as thread-safety goes - this is guarded by
@@ -96,6 +96,9 @@ typedef struct Backend_DisplayMode
 	unsigned int refresh_rate;
 } Backend_DisplayMode;
 
+typedef struct Backend_Thread Backend_Thread;
+typedef struct Backend_Mutex Backend_Mutex;
+
 bool Backend_Init(void (*drag_and_drop_callback)(const char *path), void (*window_focus_callback)(bool focus));
 void Backend_Deinit(void);
 void Backend_PostWindowCreation(void);
@@ -112,3 +115,13 @@ ATTRIBUTE_FORMAT_PRINTF(1, 2) void Backend_PrintInfo(const char *format, ...);
 unsigned long Backend_GetTicks(void);
 void Backend_Delay(unsigned int ticks);
 void Backend_GetDisplayMode(Backend_DisplayMode *display_mode);
+
+// On platforms without threads, Backend_CreateThread returns NULL and the
+// caller must run `function` itself. Backend_CreateMutex returns NULL too,
+// and locking or unlocking a NULL mutex does nothing.
+Backend_Thread* Backend_CreateThread(void (*function)(void *user_data), void *user_data);
+void Backend_JoinThread(Backend_Thread *thread);
+Backend_Mutex* Backend_CreateMutex(void);
+void Backend_DestroyMutex(Backend_Mutex *mutex);
+void Backend_LockMutex(Backend_Mutex *mutex);
+void Backend_UnlockMutex(Backend_Mutex *mutex);
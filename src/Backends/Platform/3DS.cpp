@@ -5,6 +5,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string>
 
@@ -141,3 +142,68 @@ void Backend_GetDisplayMode(Backend_DisplayMode *display_mode)
 	display_mode->height = 240;
 	display_mode->refresh_rate = 60;
 }
+
+struct Backend_Thread
+{
+	Thread thread;
+};
+
+struct Backend_Mutex
+{
+	LightLock lock;
+};
+
+Backend_Thread* Backend_CreateThread(void (*function)(void *user_data), void *user_data)
+{
+	Backend_Thread *thread = (Backend_Thread*)malloc(sizeof(Backend_Thread));
+
+	if (thread != NULL)
+	{
+		// Run below the main thread, so that the work is done in the time it spends waiting
+		s32 priority = 0x30;
+		svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+
+		thread->thread = threadCreate(function, user_data, 32 * 1024, priority < 0x3F ? priority + 1 : 0x3F, -1, false);
+
+		if (thread->thread != NULL)
+			return thread;
+
+		free(thread);
+	}
+
+	return NULL;
+}
+
+void Backend_JoinThread(Backend_Thread *thread)
+{
+	threadJoin(thread->thread, UINT64_MAX);
+	threadFree(thread->thread);
+	free(thread);
+}
+
+Backend_Mutex* Backend_CreateMutex(void)
+{
+	Backend_Mutex *mutex = (Backend_Mutex*)malloc(sizeof(Backend_Mutex));
+
+	if (mutex != NULL)
+		LightLock_Init(&mutex->lock);
+
+	return mutex;
+}
+
+void Backend_DestroyMutex(Backend_Mutex *mutex)
+{
+	free(mutex);
+}
+
+void Backend_LockMutex(Backend_Mutex *mutex)
+{
+	if (mutex != NULL)
+		LightLock_Lock(&mutex->lock);
+}
+
+void Backend_UnlockMutex(Backend_Mutex *mutex)
+{
+	if (mutex != NULL)
+		LightLock_Unlock(&mutex->lock);
+}
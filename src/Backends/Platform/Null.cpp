@@ -103,3 +103,36 @@ void Backend_GetDisplayMode(Backend_DisplayMode *display_mode)
 {
 	(void)display_mode;
 }
+
+Backend_Thread* Backend_CreateThread(void (*function)(void *user_data), void *user_data)
+{
+	(void)function;
+	(void)user_data;
+
+	return NULL;	// Not supported - the caller will do the work itself
+}
+
+void Backend_JoinThread(Backend_Thread *thread)
+{
+	(void)thread;
+}
+
+Backend_Mutex* Backend_CreateMutex(void)
+{
+	return NULL;
+}
+
+void Backend_DestroyMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
+
+void Backend_LockMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
+
+void Backend_UnlockMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
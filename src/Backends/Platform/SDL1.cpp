@@ -266,3 +266,87 @@ void Backend_GetDisplayMode(Backend_DisplayMode *display_mode)
 	display_mode->height = 720;
 	display_mode->refresh_rate = 0;	// Dummy - tricks the game into thinking it should never use vsync, which is correct
 }
+
+struct Backend_Thread
+{
+	SDL_Thread *thread;
+	void (*function)(void *user_data);
+	void *user_data;
+};
+
+struct Backend_Mutex
+{
+	SDL_mutex *mutex;
+};
+
+static int ThreadFunction(void *user_data)
+{
+	Backend_Thread *thread = (Backend_Thread*)user_data;
+
+	thread->function(thread->user_data);
+
+	return 0;
+}
+
+Backend_Thread* Backend_CreateThread(void (*function)(void *user_data), void *user_data)
+{
+	Backend_Thread *thread = (Backend_Thread*)malloc(sizeof(Backend_Thread));
+
+	if (thread != NULL)
+	{
+		thread->function = function;
+		thread->user_data = user_data;
+		thread->thread = SDL_CreateThread(ThreadFunction, thread);
+
+		if (thread->thread != NULL)
+			return thread;
+
+		free(thread);
+	}
+
+	return NULL;
+}
+
+void Backend_JoinThread(Backend_Thread *thread)
+{
+	SDL_WaitThread(thread->thread, NULL);
+	free(thread);
+}
+
+Backend_Mutex* Backend_CreateMutex(void)
+{
+	Backend_Mutex *mutex = (Backend_Mutex*)malloc(sizeof(Backend_Mutex));
+
+	if (mutex != NULL)
+	{
+		mutex->mutex = SDL_CreateMutex();
+
+		if (mutex->mutex != NULL)
+			return mutex;
+
+		free(mutex);
+	}
+
+	return NULL;
+}
+
+void Backend_DestroyMutex(Backend_Mutex *mutex)
+{
+	if (mutex != NULL)
+	{
+		SDL_DestroyMutex(mutex->mutex);
+		free(mutex);
+	}
+}
+
+void Backend_LockMutex(Backend_Mutex *mutex)
+{
+	if (mutex != NULL)
+		SDL_LockMutex(mutex->mutex);
+}
+
+void Backend_UnlockMutex(Backend_Mutex *mutex)
+{
+	if (mutex != NULL)
+		SDL_UnlockMutex(mutex->mutex);
+}
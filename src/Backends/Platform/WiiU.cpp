@@ -155,3 +155,36 @@ void Backend_GetDisplayMode(Backend_DisplayMode *display_mode)
 	display_mode->height = 480;
 	display_mode->refresh_rate = 60;
 }
+
+Backend_Thread* Backend_CreateThread(void (*function)(void *user_data), void *user_data)
+{
+	(void)function;
+	(void)user_data;
+
+	return NULL;	// Not supported - the caller will do the work itself
+}
+
+void Backend_JoinThread(Backend_Thread *thread)
+{
+	(void)thread;
+}
+
+Backend_Mutex* Backend_CreateMutex(void)
+{
+	return NULL;
+}
+
+void Backend_DestroyMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
+
+void Backend_LockMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
+
+void Backend_UnlockMutex(Backend_Mutex *mutex)
+{
+	(void)mutex;
+}
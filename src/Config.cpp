@@ -18,7 +18,8 @@
 #include "Main.h"
 
 const char* const gConfigName = "ConfigCSE2E.dat";
-const char* const gProof = "CSE2E   20200430";
+const char* const gProof = "CSE2E   20261019";
+static const char* const previous_proof = "CSE2E   20200430";	// From before the audio settings were added
 
 BOOL LoadConfigData(CONFIGDATA *conf)
 {
@@ -59,9 +60,25 @@ BOOL LoadConfigData(CONFIGDATA *conf)
 		conf->bindings[i].controller = fgetc(fp);
 	}
 
+	// Older configs are upgraded rather than thrown away, with the audio settings left at their defaults
+	const BOOL upgrade = strcmp(conf->proof, previous_proof) == 0;
+
+	if (!upgrade)
+	{
+		// Read maximum number of simultaneous sounds
+		conf->voice_limit = File_ReadLE16(fp);
+
+		// Read audio output frequency and period
+		conf->audio_frequency = File_ReadLE32(fp);
+		conf->audio_period = File_ReadLE16(fp);
+	}
+
 	// Close file
 	fclose(fp);
 
+	if (upgrade)
+		strcpy(conf->proof, gProof);
+
 	// Check if version is not correct, and return if it failed
 	if (strcmp(conf->proof, gProof))
 	{
@@ -69,6 +86,21 @@ BOOL LoadConfigData(CONFIGDATA *conf)
 		return FALSE;
 	}
 
+	// Fall back on the defaults for nonsensical audio settings
+	if (conf->audio_frequency != 0 && (conf->audio_frequency < 8000 || conf->audio_frequency > 192000))
+		conf->audio_frequency = 0;
+
+	if (conf->audio_period != 0)
+	{
+		// Round to a power of two (some backends require it), within 64 and 16384 frames
+		unsigned short period = 64;
+
+		while (period < conf->audio_period && period < 16384)
+			period <<= 1;
+
+		conf->audio_period = period;
+	}
+
 	return TRUE;
 }
 
@@ -108,6 +140,13 @@ BOOL SaveConfigData(const CONFIGDATA *conf)
 		fputc(conf->bindings[i].controller, fp);
 	}
 
+	// Write maximum number of simultaneous sounds
+	File_WriteLE16(conf->voice_limit, fp);
+
+	// Write audio output frequency and period
+	File_WriteLE32(conf->audio_frequency, fp);
+	File_WriteLE16(conf->audio_period, fp);
+
 	// Close file
 	fclose(fp);
 
@@ -45,6 +45,9 @@ struct CONFIGDATA
 	BOOL bSmoothScrolling;
 	unsigned char soundtrack;
 	CONFIG_BINDING bindings[BINDING_TOTAL];
+	unsigned short voice_limit;
+	unsigned long audio_frequency;	// 0 lets the audio backend decide
+	unsigned short audio_period;	// In frames - 0 lets the audio backend decide
 };
 
 extern const char* const gConfigName;
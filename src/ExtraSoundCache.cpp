@@ -0,0 +1,412 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Predecoded ExtraSound sound effects are saved to a file next to the executable, so that they
+// don't need to be decoded again the next time the game is launched. Sounds are looked up by a
+// hash of their file's contents, along with the sample rate and channel count that they were
+// decoded for, so replacing a file just makes it miss the cache.
+//
+// The samples are stored in the machine's own byte order so that the mixer can play them straight
+// out of the file, which is mapped into memory in one go where the platform allows it. A new cache
+// is written to a temporary file and then renamed over the old one, so two copies of the game
+// saving at once can't leave a half-written cache behind (one of them just wins).
+
+#include "ExtraSoundCache.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+ #include <unistd.h>
+ #if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+  #define HAVE_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+ #endif
+#elif defined(_WIN32)
+ #include <process.h>
+#endif
+
+#include "WindowsWrapper.h"
+
+#include "Backends/Misc.h"
+#include "File.h"
+#include "Main.h"
+
+// Change the last character whenever the decoders' output changes, so that old caches are thrown away
+static const char cache_magic[8] = {'X', 'S', 'N', 'D', 'C', 'A', 'C', '1'};
+static const char* const cache_name = "ExtraSoundCache.dat";
+
+static const uint32_t byte_order_mark = 0x01020304;	// Caches from machines with the other byte order are ignored
+
+#define MAX_CACHE_SIZE (64 * 1024 * 1024)	// Sounds that don't fit aren't saved
+#define HEADER_SIZE (sizeof(cache_magic) + 4 + 4)
+#define ENTRY_HEADER_SIZE (7 * 4)
+
+typedef struct CacheEntry
+{
+	ExtraSoundCacheKey key;
+	short *samples;	// Either points into file_buffer, or was allocated by ExtraSoundCache_Add
+	size_t frames;
+	unsigned long sample_rate;
+	BOOL owns_samples;
+	BOOL used;	// Only sounds that were used this session get saved
+} CacheEntry;
+
+static CacheEntry *entries;
+static size_t total_entries;
+static size_t entry_capacity;
+static size_t used_size;	// How big the cache would be if it were saved now
+
+static unsigned char *file_buffer;
+static size_t file_buffer_size;
+static BOOL file_buffer_mapped;
+
+static Backend_Mutex *cache_mutex;
+static BOOL cache_dirty;
+
+// Each entry's samples are padded to 4 bytes, so that the next entry's samples are aligned too
+static size_t GetSamplesSize(const ExtraSoundCacheKey *key, size_t frames)
+{
+	return (frames * key->channel_count * sizeof(short) + 3) & ~(size_t)3;
+}
+
+static CacheEntry* FindEntry(const ExtraSoundCacheKey *key)
+{
+	for (size_t i = 0; i < total_entries; ++i)
+		if (memcmp(&entries[i].key, key, sizeof(ExtraSoundCacheKey)) == 0)
+			return &entries[i];
+
+	return NULL;
+}
+
+static CacheEntry* NewEntry(void)
+{
+	if (total_entries == entry_capacity)
+	{
+		const size_t new_capacity = entry_capacity == 0 ? 0x40 : entry_capacity * 2;
+		CacheEntry *new_entries = (CacheEntry*)realloc(entries, new_capacity * sizeof(CacheEntry));
+
+		if (new_entries == NULL)
+			return NULL;
+
+		entries = new_entries;
+		entry_capacity = new_capacity;
+	}
+
+	return &entries[total_entries++];
+}
+
+// Marks the entry as one to save, unless that would make the cache too big
+static void UseEntry(CacheEntry *entry)
+{
+	if (!entry->used)
+	{
+		const size_t entry_size = ENTRY_HEADER_SIZE + GetSamplesSize(&entry->key, entry->frames);
+
+		if (used_size + entry_size <= MAX_CACHE_SIZE - HEADER_SIZE)
+		{
+			used_size += entry_size;
+			entry->used = TRUE;
+			cache_dirty = TRUE;
+		}
+	}
+}
+
+static unsigned long ReadNative32(const unsigned char *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static void WriteNative32(unsigned long value, FILE *fp)
+{
+	const uint32_t value32 = (uint32_t)value;
+	fwrite(&value32, sizeof(value32), 1, fp);
+}
+
+static BOOL MapCacheFile(const char *path)
+{
+#ifdef HAVE_MMAP
+	BOOL success = FALSE;
+
+	int file = open(path, O_RDONLY);
+
+	if (file != -1)
+	{
+		struct stat file_status;
+
+		if (fstat(file, &file_status) == 0 && file_status.st_size > 0)
+		{
+			void *mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+			if (mapping != MAP_FAILED)
+			{
+				file_buffer = (unsigned char*)mapping;
+				file_buffer_size = file_status.st_size;
+				file_buffer_mapped = TRUE;
+				success = TRUE;
+			}
+		}
+
+		// The mapping stays valid after the file is closed, and even after a newer cache is renamed over it
+		close(file);
+	}
+
+	return success;
+#else
+	(void)path;
+
+	return FALSE;
+#endif
+}
+
+static void UnloadCacheFile(void)
+{
+#ifdef HAVE_MMAP
+	if (file_buffer_mapped)
+		munmap(file_buffer, file_buffer_size);
+	else
+#endif
+		free(file_buffer);
+
+	file_buffer = NULL;
+	file_buffer_size = 0;
+	file_buffer_mapped = FALSE;
+}
+
+void ExtraSoundCache_Load(void)
+{
+	cache_mutex = Backend_CreateMutex();
+
+	std::string path = gModulePath + '/' + cache_name;
+
+	if (!MapCacheFile(path.c_str()))
+	{
+		file_buffer = LoadFileToMemory(path.c_str(), &file_buffer_size);
+
+		if (file_buffer == NULL)
+			return;
+	}
+
+	if (file_buffer_size < HEADER_SIZE || memcmp(file_buffer, cache_magic, sizeof(cache_magic)) != 0 || ReadNative32(file_buffer + sizeof(cache_magic)) != byte_order_mark)
+	{
+		UnloadCacheFile();
+		return;
+	}
+
+	const unsigned char *p = file_buffer + HEADER_SIZE;
+	const unsigned char *file_end = file_buffer + file_buffer_size;
+
+	unsigned long count = ReadNative32(file_buffer + sizeof(cache_magic) + 4);
+
+	// If the file is truncated, just keep whatever could be read
+	while (count-- != 0)
+	{
+		if ((size_t)(file_end - p) < ENTRY_HEADER_SIZE)
+			break;
+
+		ExtraSoundCacheKey key;
+		key.hash_low = ReadNative32(p);
+		key.hash_high = ReadNative32(p + 4);
+		key.file_size = ReadNative32(p + 8);
+		key.wanted_sample_rate = ReadNative32(p + 12);
+		key.channel_count = ReadNative32(p + 16);
+		const unsigned long sample_rate = ReadNative32(p + 20);
+		const size_t frames = ReadNative32(p + 24);
+		p += ENTRY_HEADER_SIZE;
+
+		if (key.channel_count == 0 || key.channel_count > 2 || frames > (size_t)(file_end - p) / (key.channel_count * sizeof(short)) || (size_t)(file_end - p) < GetSamplesSize(&key, frames))
+			break;
+
+		CacheEntry *entry = NewEntry();
+
+		if (entry == NULL)
+			break;
+
+		entry->key = key;
+		entry->samples = (short*)p;
+		entry->frames = frames;
+		entry->sample_rate = sample_rate;
+		entry->owns_samples = FALSE;
+		entry->used = FALSE;
+
+		p += GetSamplesSize(&key, frames);
+	}
+}
+
+// No two running copies of the game share a process ID, so this keeps their temporary files apart
+static unsigned long GetProcessID(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	return (unsigned long)getpid();
+#elif defined(_WIN32)
+	return (unsigned long)_getpid();
+#else
+	return 0;	// Consoles can only run one copy of the game at a time
+#endif
+}
+
+void ExtraSoundCache_Save(void)
+{
+	char temporary_suffix[0x20];
+	size_t i;
+	unsigned long count;
+
+	Backend_LockMutex(cache_mutex);
+
+	if (cache_dirty)
+	{
+		std::string path = gModulePath + '/' + cache_name;
+
+		// Another copy of the game could be saving at the same time, so give the temporary file a name of its own
+		sprintf(temporary_suffix, ".%lX.%lX.tmp", GetProcessID(), Backend_GetTicks());
+		std::string temporary_path = path + temporary_suffix;
+
+		FILE *fp = fopen(temporary_path.c_str(), "wb");
+
+		if (fp != NULL)
+		{
+			count = 0;
+			for (i = 0; i < total_entries; ++i)
+				if (entries[i].used)
+					++count;
+
+			fwrite(cache_magic, sizeof(cache_magic), 1, fp);
+			WriteNative32(byte_order_mark, fp);
+			WriteNative32(count, fp);
+
+			for (i = 0; i < total_entries; ++i)
+			{
+				if (entries[i].used)
+				{
+					static const unsigned char padding[3] = {0, 0, 0};
+
+					const size_t samples_size = entries[i].frames * entries[i].key.channel_count * sizeof(short);
+
+					WriteNative32(entries[i].key.hash_low, fp);
+					WriteNative32(entries[i].key.hash_high, fp);
+					WriteNative32(entries[i].key.file_size, fp);
+					WriteNative32(entries[i].key.wanted_sample_rate, fp);
+					WriteNative32(entries[i].key.channel_count, fp);
+					WriteNative32(entries[i].sample_rate, fp);
+					WriteNative32((unsigned long)entries[i].frames, fp);
+					fwrite(entries[i].samples, samples_size, 1, fp);
+					fwrite(padding, GetSamplesSize(&entries[i].key, entries[i].frames) - samples_size, 1, fp);
+				}
+			}
+
+			const BOOL write_failed = ferror(fp) != 0;
+
+			if (fclose(fp) != 0 || write_failed)
+			{
+				remove(temporary_path.c_str());
+			}
+			else if (rename(temporary_path.c_str(), path.c_str()) != 0)
+			{
+				// Windows won't rename over an existing file
+				remove(path.c_str());
+
+				if (rename(temporary_path.c_str(), path.c_str()) != 0)
+					remove(temporary_path.c_str());
+			}
+		}
+
+		cache_dirty = FALSE;
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+}
+
+void ExtraSoundCache_Free(void)
+{
+	for (size_t i = 0; i < total_entries; ++i)
+		if (entries[i].owns_samples)
+			free(entries[i].samples);
+
+	free(entries);
+	entries = NULL;
+	total_entries = 0;
+	entry_capacity = 0;
+	used_size = 0;
+
+	UnloadCacheFile();
+
+	Backend_DestroyMutex(cache_mutex);
+	cache_mutex = NULL;
+
+	cache_dirty = FALSE;
+}
+
+const short* ExtraSoundCache_Find(const ExtraSoundCacheKey *key, size_t *frames, unsigned long *sample_rate)
+{
+	const short *samples = NULL;
+
+	Backend_LockMutex(cache_mutex);
+
+	CacheEntry *entry = FindEntry(key);
+
+	if (entry != NULL)
+	{
+		samples = entry->samples;
+		*frames = entry->frames;
+		*sample_rate = entry->sample_rate;
+
+		// If the cache has already been saved without this sound, it needs saving again
+		UseEntry(entry);
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+
+	return samples;
+}
+
+void ExtraSoundCache_Add(const ExtraSoundCacheKey *key, const short *samples, size_t frames, unsigned long sample_rate)
+{
+	if (frames == 0 || key->channel_count == 0 || key->channel_count > 2)
+		return;
+
+	const size_t samples_size = frames * key->channel_count * sizeof(short);
+
+	short *samples_copy = (short*)malloc(samples_size);
+
+	if (samples_copy == NULL)
+		return;
+
+	memcpy(samples_copy, samples, samples_size);
+
+	Backend_LockMutex(cache_mutex);
+
+	CacheEntry *entry = FindEntry(key);
+
+	// Another thread might have decoded the same sound in the meantime, and there's no point in keeping
+	// a copy of a sound that won't get saved
+	if (entry == NULL && used_size + ENTRY_HEADER_SIZE + GetSamplesSize(key, frames) <= MAX_CACHE_SIZE - HEADER_SIZE)
+	{
+		entry = NewEntry();
+
+		if (entry != NULL)
+		{
+			entry->key = *key;
+			entry->samples = samples_copy;
+			entry->frames = frames;
+			entry->sample_rate = sample_rate;
+			entry->owns_samples = TRUE;
+			entry->used = FALSE;
+
+			samples_copy = NULL;
+
+			UseEntry(entry);
+		}
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+
+	free(samples_copy);
+}
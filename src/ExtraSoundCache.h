@@ -0,0 +1,21 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct ExtraSoundCacheKey
+{
+	unsigned long hash_low;	// A 64-bit hash of the file's contents
+	unsigned long hash_high;
+	unsigned long file_size;
+	unsigned long wanted_sample_rate;	// 0 if the sound was left at its own sample rate
+	unsigned long channel_count;
+} ExtraSoundCacheKey;
+
+void ExtraSoundCache_Load(void);
+void ExtraSoundCache_Save(void);
+void ExtraSoundCache_Free(void);
+const short* ExtraSoundCache_Find(const ExtraSoundCacheKey *key, size_t *frames, unsigned long *sample_rate);	// The samples stay valid until ExtraSoundCache_Free, or NULL if the sound isn't cached
+void ExtraSoundCache_Add(const ExtraSoundCacheKey *key, const short *samples, size_t frames, unsigned long sample_rate);
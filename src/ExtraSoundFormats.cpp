@@ -1,330 +1,1442 @@
 #include "ExtraSoundFormats.h"
 
-#include <math.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <string>
 
+#include "Backends/Audio.h"
+#include "Backends/Misc.h"
+#ifdef EXTRA_SOUND_CACHE
+#include "ExtraSoundCache.h"
+#endif
+#include "File.h"
 #include "Sound.h"
 
 #include "clownaudio/mixer.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-#define CLAMP(x, y, z) MIN(MAX((x), (y)), (z))
+
+// clownaudio only decodes the sounds - each one is handed to the audio backend as a stream,
+// so that it gets mixed in the same pass as the game's own sounds
+
+// Songs are decoded ahead of time by a worker thread, so that the audio callback only ever has
+// to copy samples out of a ring buffer. Decoding in the callback meant that an Ogg page boundary
+// or the switch from the intro to the loop could make it miss its deadline.
+#define DECODE_AHEAD_MILLISECONDS 250
+#define DECODE_AHEAD_CHUNK_FRAMES 0x400	// The worker doesn't bother topping the ring up with less than this
+#define DECODE_AHEAD_INTERVAL 10	// How often the worker checks the rings, in milliseconds
+
+typedef struct DecodeRing
+{
+	ClownAudio_Sound *sound;
+	short *buffer;
+	size_t size;	// In frames - always a power of two
+	unsigned long read_position;	// Only the audio callback advances this
+	unsigned long write_position;	// Only the worker advances this
+	bool finished;	// Set once the decoder has run out of samples
+	struct DecodeRing *next;
+} DecodeRing;
 
 typedef struct SoundSlot
 {
 	bool valid;
 	ClownAudio_SoundData *sound_data;
 	ClownAudio_SoundID sound_id;
+	AudioBackend_Sound *stream;
+	DecodeRing *ring;	// NULL if the sound is decoded as it's mixed
+	bool unpaused;	// Whether the stream should play while ExtraSound is playing
+} SoundSlot;
+
+// Predecoded sound effects are shared by every slot that loads the same file, and are played by
+// voices from a fixed pool, so that an effect can overlap itself without anything being allocated
+// when it's triggered. A voice is just a position in the shared samples, and a stream to mix it with.
+#define SFX_VOICE_COUNT 32
+
+typedef struct SFXData
+{
+	ClownAudio_SoundData *sound_data;	// NULL if the samples belong to the cache
+	const short *samples;
+	size_t frames;	// Never 0
+	unsigned long sample_rate;
+	unsigned long hash_low;
+	unsigned long hash_high;
+	size_t file_size;
+	unsigned int reference_count;
+	struct SFXData *next;
+} SFXData;
+
+typedef struct SFXVoice
+{
+	AudioBackend_Sound *stream;
+	const SFXData *data;	// NULL while the voice is free - the audio callback clears it once the sound ends
+	int effect;	// Which slot in `sfx_list` last started the voice
+	unsigned long position;	// In frames
+	unsigned long position_fraction;	// 16 fractional bits
+	unsigned long step;	// How far the position moves with each output frame, with 16 fractional bits
+	bool loop;
+	unsigned long start_order;	// For finding the oldest voice when they're all busy
+} SFXVoice;
+
+typedef struct SFXEffect
+{
+	SFXData *data;	// NULL if the sound couldn't be predecoded
+	SoundSlot streamed;	// Used instead of `data` for sounds that couldn't be predecoded, which can't overlap themselves
+	unsigned long frequency;	// These are applied to every voice that the effect starts
 	long volume;
 	long pan;
-} SoundSlot;
+} SFXEffect;
+
+// Replacement sound effects are all loaded at startup, and predecoding them can take a while, so
+// they're loaded by a few worker threads. Only turning the decoded sounds into effects is left to
+// the thread that asked for them, since that registers them with the mixer and the audio backend.
+#define SFX_LOAD_WORKERS 4
+
+typedef struct SFXLoadJob
+{
+	const char *path;
+	int id;
+
+	// Filled in by the workers
+	bool loaded;	// Whether the file could be loaded at all
+	unsigned long hash_low;
+	unsigned long hash_high;
+	size_t file_size;
+	SFXData *existing_data;	// Set if the file was already predecoded before this batch of sounds
+	bool decoding;	// Whether this job decodes the file itself, rather than sharing another job's sound
+	bool shares_sound;	// Set if another job in the batch decodes the same file
+	ClownAudio_SoundData *sound_data;	// NULL if the samples came from the cache
+	const short *samples;	// NULL if the sound couldn't be predecoded, and has to be streamed instead
+	size_t frames;
+	unsigned long sample_rate;
+	unsigned long milliseconds;
+} SFXLoadJob;
 
 static ClownAudio_Mixer *mixer;
+static unsigned long output_sample_rate;
 
 static SoundSlot song;
 static SoundSlot previous_song;
 
-static SoundSlot sfx_list[SE_MAX];
+static SFXEffect sfx_list[SE_MAX];
+static SFXData *sfx_data_list;
+static SFXVoice sfx_voices[SFX_VOICE_COUNT];	// Only changed while the audio backend is locked, since the audio callback uses them
+static unsigned long voice_start_counter;
+
+static SFXLoadJob *sfx_load_jobs;
+static size_t total_sfx_load_jobs;
+static size_t sfx_load_next_job;
+static Backend_Mutex *sfx_load_mutex;	// Guards `sfx_load_next_job`, and which jobs are decoding which files
 
 static bool playing = true;
 
-static unsigned short MillibelToScale(long volume)
+// Songs are loaded on a worker thread, so that changing the music doesn't hold up the game.
+// Until the song is ready, anything the game asks of it is kept in the 'pending' variables.
+// The worker can also load a song before it's asked for (a prefetch), in which case the song
+// waits in `prefetched_song` until ExtraSound_LoadMusic asks for it, and can then start at once.
+// If the game asks for some other song instead, the prefetch is abandoned: the worker throws it
+// away when it's done with it, and then loads the new song, so the game never waits for it.
+static Backend_Thread *load_thread;
+static Backend_Mutex *load_mutex;	// Guards `song` while a song is loading, and everything below
+static bool load_running;	// Whether the worker is still going
+static bool load_pending;	// Whether the worker is loading the song that the game wants to play, rather than prefetching one
+static bool load_abandoned;	// Whether the song that the worker is on has been replaced by the one in `load_intro_path` and co.
+static std::string load_intro_path;
+static std::string load_loop_path;
+static bool load_loop;
+static bool pending_volume_set;
+static unsigned short pending_volume;
+static bool pending_unpause;
+
+static SoundSlot prefetched_song;
+static std::string prefetch_intro_path;	// Which song `prefetched_song` is, or is being loaded as
+static std::string prefetch_loop_path;
+static bool prefetch_loop;
+
+// How long loading sounds has taken, reported when ExtraSound is shut down. Also guarded by `load_mutex`.
+static ClownAudio_LoadStats load_stats;
+static unsigned long load_milliseconds;
+
+static Backend_Thread *decode_ahead_thread;
+static Backend_Mutex *decode_ahead_mutex;	// Held by the worker while it decodes, and guards the list of rings
+static Backend_Mutex *ring_mutex;	// Guards the rings' positions, and the underrun count
+static bool decode_ahead_running;
+static DecodeRing *decode_rings;
+static size_t decode_ring_size;
+static unsigned long underrun_count;
+
+static size_t StreamCallback(void *user_data, short *buffer, size_t frames)
 {
-	// Volume is in hundredths of a decibel, from 0 to -10000
-	volume = CLAMP(volume, -10000, 0);
-	return (unsigned short)(pow(10.0, volume / 2000.0) * 256.0f);
+	return ClownAudio_Sound_GetSamples((ClownAudio_Sound*)user_data, buffer, frames);
 }
 
-void ExtraSound_Init(unsigned int sample_rate)
+// Runs in the audio callback, so this must never wait on the decoder
+static size_t DecodeAheadCallback(void *user_data, short *buffer, size_t frames)
 {
-	mixer = ClownAudio_CreateMixer(sample_rate);
+	DecodeRing *ring = (DecodeRing*)user_data;
+
+	Backend_LockMutex(ring_mutex);
+	const unsigned long read_position = ring->read_position;
+	const size_t frames_available = ring->write_position - read_position;
+	const bool finished = ring->finished;
+	Backend_UnlockMutex(ring_mutex);
+
+	const size_t frames_done = MIN(frames, frames_available);
+	const size_t offset = read_position & (ring->size - 1);
+	const size_t frames_before_wrap = MIN(frames_done, ring->size - offset);
+
+	memcpy(buffer, &ring->buffer[offset * 2], frames_before_wrap * 2 * sizeof(short));
+	memcpy(&buffer[frames_before_wrap * 2], ring->buffer, (frames_done - frames_before_wrap) * 2 * sizeof(short));
+
+	const bool underrun = frames_done != frames && !finished;
+
+	Backend_LockMutex(ring_mutex);
+	ring->read_position += frames_done;
+
+	if (underrun)
+		++underrun_count;
+
+	Backend_UnlockMutex(ring_mutex);
+
+	if (underrun)
+	{
+		// The worker fell behind - play silence instead of letting the mixer think that the song has ended
+		memset(&buffer[frames_done * 2], 0, (frames - frames_done) * 2 * sizeof(short));
+		return frames;
+	}
+
+	return frames_done;
 }
 
-void ExtraSound_Deinit(void)
+// Runs in the audio callback, with the audio backend locked
+static size_t VoiceCallback(void *user_data, short *buffer, size_t frames)
 {
-	// Free songs
-	if (previous_song.valid)
+	SFXVoice *voice = (SFXVoice*)user_data;
+	const SFXData *data = voice->data;
+
+	if (data == NULL)
+		return 0;
+
+	size_t frames_done;
+
+	for (frames_done = 0; frames_done < frames; ++frames_done)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_DestroySound(mixer, previous_song.sound_id);
-		AudioBackend_Unlock();
+		if (voice->position >= data->frames)
+		{
+			if (!voice->loop)
+			{
+				voice->data = NULL;
+				break;
+			}
+
+			voice->position %= data->frames;
+		}
+
+		// Interpolate towards the next frame, which is the first one again when looping
+		const short *current = &data->samples[voice->position * 2];
+		const short *next = voice->position + 1 < data->frames ? current + 2 : (voice->loop ? data->samples : current);
+		const long fraction = (long)(voice->position_fraction >> 1);	// Only 15 bits, so that this can't overflow
 
-		ClownAudio_Mixer_UnloadSoundData(previous_song.sound_data);
-		previous_song.valid = false;
+		buffer[frames_done * 2 + 0] = (short)(current[0] + (((next[0] - current[0]) * fraction) >> 15));
+		buffer[frames_done * 2 + 1] = (short)(current[1] + (((next[1] - current[1]) * fraction) >> 15));
+
+		voice->position_fraction += voice->step;
+		voice->position += voice->position_fraction >> 16;
+		voice->position_fraction &= 0xFFFF;
 	}
 
-	if (song.valid)
+	return frames_done;
+}
+
+static void FillRing(DecodeRing *ring)
+{
+	for (;;)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_DestroySound(mixer, song.sound_id);
-		AudioBackend_Unlock();
+		Backend_LockMutex(ring_mutex);
+		const unsigned long write_position = ring->write_position;
+		const size_t frames_free = ring->size - (write_position - ring->read_position);
+		const bool finished = ring->finished;
+		Backend_UnlockMutex(ring_mutex);
+
+		if (finished || frames_free < DECODE_AHEAD_CHUNK_FRAMES)
+			return;
+
+		// The callback doesn't touch the free part of the ring, so it can be decoded into directly
+		const size_t offset = write_position & (ring->size - 1);
+		const size_t frames_to_do = MIN(frames_free, ring->size - offset);
+		const size_t frames_done = ClownAudio_Sound_GetSamples(ring->sound, &ring->buffer[offset * 2], frames_to_do);
+
+		Backend_LockMutex(ring_mutex);
+		ring->write_position += frames_done;
+
+		if (frames_done != frames_to_do)
+			ring->finished = true;
 
-		ClownAudio_Mixer_UnloadSoundData(song.sound_data);
-		song.valid = false;
+		Backend_UnlockMutex(ring_mutex);
 	}
+}
 
-	// Free SFX
-	for (unsigned int i = 0; i < SE_MAX; ++i)
+static void DecodeAheadThread(void *user_data)
+{
+	(void)user_data;
+
+	for (;;)
 	{
-		if (sfx_list[i].valid)
+		Backend_LockMutex(decode_ahead_mutex);
+
+		if (!decode_ahead_running)
 		{
-			AudioBackend_Lock();
-			ClownAudio_Mixer_DestroySound(mixer, sfx_list[i].sound_id);
-			AudioBackend_Unlock();
+			Backend_UnlockMutex(decode_ahead_mutex);
+			break;
+		}
+
+		for (DecodeRing *ring = decode_rings; ring != NULL; ring = ring->next)
+			FillRing(ring);
+
+		Backend_UnlockMutex(decode_ahead_mutex);
+
+		Backend_Delay(DECODE_AHEAD_INTERVAL);
+	}
+}
+
+// The ring is filled before it's returned, so that the song doesn't start with an underrun
+static DecodeRing* CreateRing(ClownAudio_Sound *sound)
+{
+	DecodeRing *ring = (DecodeRing*)malloc(sizeof(DecodeRing));
+
+	if (ring != NULL)
+	{
+		ring->buffer = (short*)malloc(decode_ring_size * 2 * sizeof(short));
+
+		if (ring->buffer != NULL)
+		{
+			ring->sound = sound;
+			ring->size = decode_ring_size;
+			ring->read_position = 0;
+			ring->write_position = 0;
+			ring->finished = false;
+			ring->next = NULL;
+
+			FillRing(ring);
 
-			ClownAudio_Mixer_UnloadSoundData(sfx_list[i].sound_data);
-			sfx_list[i].valid = false;
+			return ring;
 		}
+
+		free(ring);
 	}
 
-	ClownAudio_DestroyMixer(mixer);
+	return NULL;
 }
 
-void ExtraSound_Play(void)
+static void DestroyRing(DecodeRing *ring)
 {
-	playing = true;
+	free(ring->buffer);
+	free(ring);
 }
 
-void ExtraSound_Stop(void)
+static void UpdateStream(const SoundSlot *slot)
 {
-	playing = false;
+	if (!slot->valid)
+		return;
+
+	if (playing && slot->unpaused)
+		AudioBackend_PlaySound(slot->stream, false);
+	else
+		AudioBackend_StopSound(slot->stream);
 }
 
-void ExtraSound_LoadMusic(const char *intro_file_path, const char *loop_file_path, bool loop)
+static void UpdateAllStreams(void)
 {
-	if (previous_song.valid)
+	Backend_LockMutex(load_mutex);
+	UpdateStream(&song);
+	UpdateStream(&previous_song);
+	Backend_UnlockMutex(load_mutex);
+
+	for (unsigned int i = 0; i < SE_MAX; ++i)
+		UpdateStream(&sfx_list[i].streamed);
+
+	for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
 	{
+		if (sfx_voices[i].stream == NULL)
+			continue;
+
 		AudioBackend_Lock();
-		ClownAudio_Mixer_DestroySound(mixer, previous_song.sound_id);
+		const bool voice_playing = sfx_voices[i].data != NULL;
 		AudioBackend_Unlock();
 
-		ClownAudio_Mixer_UnloadSoundData(previous_song.sound_data);
+		if (playing && voice_playing)
+			AudioBackend_PlaySound(sfx_voices[i].stream, false);
+		else
+			AudioBackend_StopSound(sfx_voices[i].stream);
 	}
+}
 
-	if (song.valid)
+// Takes ownership of `sound_data` - it's unloaded if the sound can't be made.
+// Without threads, sounds that should be decoded ahead are just decoded as they're mixed.
+static bool CreateSlot(SoundSlot *slot, ClownAudio_SoundData *sound_data, ClownAudio_SoundConfig *sound_config, bool decode_ahead)
+{
+	ClownAudio_Sound *sound = ClownAudio_Mixer_CreateSound(mixer, sound_data, sound_config);
+
+	if (sound != NULL)
 	{
 		AudioBackend_Lock();
-		ClownAudio_Mixer_PauseSound(mixer, song.sound_id);
+		slot->sound_id = ClownAudio_Mixer_RegisterSound(mixer, sound);
 		AudioBackend_Unlock();
 	}
 
-	previous_song = song;
-
-	if (intro_file_path != NULL || loop_file_path != NULL)
+	// Registering destroys the sound if it fails
+	if (sound != NULL && slot->sound_id != 0)
 	{
-		ClownAudio_SoundDataConfig data_config;
-		ClownAudio_InitSoundDataConfig(&data_config);
-		song.sound_data = ClownAudio_Mixer_LoadSoundDataFromFiles(mixer, intro_file_path, loop_file_path, &data_config);
+		slot->ring = decode_ahead && decode_ahead_thread != NULL ? CreateRing(sound) : NULL;
 
-		if (song.sound_data != NULL)
-		{
-			ClownAudio_SoundConfig sound_config;
-			ClownAudio_InitSoundConfig(&sound_config);
-			sound_config.loop = loop;
-			ClownAudio_Sound *sound = ClownAudio_Mixer_CreateSound(mixer, song.sound_data, &sound_config);
+		if (slot->ring != NULL)
+			slot->stream = AudioBackend_CreateStream(DecodeAheadCallback, slot->ring);
+		else
+			slot->stream = AudioBackend_CreateStream(StreamCallback, sound);
 
-			if (sound != NULL)
+		if (slot->stream != NULL)
+		{
+			if (slot->ring != NULL)
 			{
-				AudioBackend_Lock();
-				song.sound_id = ClownAudio_Mixer_RegisterSound(mixer, sound);
-				AudioBackend_Unlock();
-
-				song.valid = true;
-
-				return;
+				// From here on, only the worker may decode the sound
+				Backend_LockMutex(decode_ahead_mutex);
+				slot->ring->next = decode_rings;
+				decode_rings = slot->ring;
+				Backend_UnlockMutex(decode_ahead_mutex);
 			}
 
-			ClownAudio_Mixer_UnloadSoundData(song.sound_data);
+			slot->sound_data = sound_data;
+			slot->unpaused = false;
+			slot->valid = true;
+			return true;
 		}
+
+		if (slot->ring != NULL)
+			DestroyRing(slot->ring);
+
+		AudioBackend_Lock();
+		ClownAudio_Mixer_DestroySound(mixer, slot->sound_id);
+		AudioBackend_Unlock();
 	}
 
-	song.valid = false;
+	ClownAudio_Mixer_UnloadSoundData(sound_data);
+
+	slot->valid = false;
+	return false;
 }
 
-void ExtraSound_LoadPreviousMusic(void)
+static void FreeSlot(SoundSlot *slot)
 {
-	if (song.valid)
+	if (!slot->valid)
+		return;
+
+	// The stream has to go first, so that the mixer stops pulling from the sound
+	AudioBackend_DestroySound(slot->stream);
+
+	if (slot->ring != NULL)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_DestroySound(mixer, song.sound_id);
-		AudioBackend_Unlock();
+		// This waits for the worker to finish with the ring
+		Backend_LockMutex(decode_ahead_mutex);
+
+		for (DecodeRing **ring = &decode_rings; *ring != NULL; ring = &(*ring)->next)
+		{
+			if (*ring == slot->ring)
+			{
+				*ring = slot->ring->next;
+				break;
+			}
+		}
 
-		ClownAudio_Mixer_UnloadSoundData(song.sound_data);
-		song.valid = false;
+		Backend_UnlockMutex(decode_ahead_mutex);
+
+		DestroyRing(slot->ring);
 	}
 
-	if (previous_song.valid)
-	{
-		song = previous_song;
+	AudioBackend_Lock();
+	ClownAudio_Mixer_DestroySound(mixer, slot->sound_id);
+	AudioBackend_Unlock();
 
-		AudioBackend_Lock();
-		ClownAudio_Mixer_CancelFade(mixer, song.sound_id);
-		AudioBackend_Unlock();
+	ClownAudio_Mixer_UnloadSoundData(slot->sound_data);
+	slot->valid = false;
+}
+
+static ClownAudio_SoundData* LoadSoundData(const char *intro_path, const char *loop_path, ClownAudio_SoundDataConfig *data_config)
+{
+	ClownAudio_LoadStats stats;
+	stats.files = 0;
+	stats.probes = 0;
+	stats.sniff_misses = 0;
+	data_config->stats = &stats;
+
+	const unsigned long start_ticks = Backend_GetTicks();
+	ClownAudio_SoundData *sound_data = ClownAudio_Mixer_LoadSoundDataFromFiles(mixer, intro_path, loop_path, data_config);
+	const unsigned long ticks_taken = Backend_GetTicks() - start_ticks;
+
+	Backend_LockMutex(load_mutex);
+	load_stats.files += stats.files;
+	load_stats.probes += stats.probes;
+	load_stats.sniff_misses += stats.sniff_misses;
+	load_milliseconds += ticks_taken;
+	Backend_UnlockMutex(load_mutex);
+
+	return sound_data;
+}
+
+// 64-bit FNV-1a (the constants are built from halves, since C++98 has no 64-bit literals)
+static void HashFile(const unsigned char *file_buffer, size_t file_size, unsigned long *hash_low, unsigned long *hash_high)
+{
+	const uint64_t prime = ((uint64_t)1 << 40) | 0x1B3;
+	uint64_t hash = ((uint64_t)0xCBF29CE4 << 32) | 0x84222325;
+
+	for (size_t i = 0; i < file_size; ++i)
+	{
+		hash ^= file_buffer[i];
+		hash *= prime;
 	}
 
-	previous_song.valid = false;
+	*hash_low = (unsigned long)(hash & 0xFFFFFFFF);
+	*hash_high = (unsigned long)(hash >> 32);
 }
 
-void ExtraSound_PauseMusic(void)
+// Takes ownership of `sound_data` (which can be NULL) - it's unloaded if the data can't be made
+static SFXData* CreateSFXData(ClownAudio_SoundData *sound_data, const short *samples, size_t frames, unsigned long sample_rate, unsigned long hash_low, unsigned long hash_high, size_t file_size)
 {
-	if (song.valid)
+	SFXData *data = (SFXData*)malloc(sizeof(SFXData));
+
+	if (data == NULL)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_PauseSound(mixer, song.sound_id);
-		AudioBackend_Unlock();
+		ClownAudio_Mixer_UnloadSoundData(sound_data);
+		return NULL;
 	}
+
+	data->sound_data = sound_data;
+	data->samples = samples;
+	data->frames = frames;
+	data->sample_rate = sample_rate;
+	data->hash_low = hash_low;
+	data->hash_high = hash_high;
+	data->file_size = file_size;
+	data->reference_count = 1;
+	data->next = sfx_data_list;
+	sfx_data_list = data;
+
+	return data;
 }
 
-void ExtraSound_UnpauseMusic(void)
+// Nothing may be playing the data when the last reference goes
+static void ReleaseSFXData(SFXData *data)
 {
-	if (song.valid)
+	if (--data->reference_count != 0)
+		return;
+
+	for (SFXData **link = &sfx_data_list; *link != NULL; link = &(*link)->next)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_UnpauseSound(mixer, song.sound_id);
-		AudioBackend_Unlock();
+		if (*link == data)
+		{
+			*link = data->next;
+			break;
+		}
 	}
+
+	ClownAudio_Mixer_UnloadSoundData(data->sound_data);
+	free(data);
 }
 
-void ExtraSound_FadeOutMusic(void)
+// How far a voice moves through a sound with each output frame, with 16 fractional bits
+static unsigned long GetVoiceStep(unsigned long frequency)
 {
-	AudioBackend_Lock();
-	ClownAudio_Mixer_FadeOutSound(mixer, song.sound_id, 5 * 1000);
-	AudioBackend_Unlock();
+	return (unsigned long)(((uint64_t)frequency << 16) / output_sample_rate);
 }
 
-void ExtraSound_SetMusicVolume(unsigned short volume)
+static void StartVoice(int id, bool loop)
 {
-	const unsigned short volume_linear = (volume * volume) >> 8;
+	const SFXEffect *effect = &sfx_list[id];
+	SFXVoice *voice = NULL;
+	unsigned int i;
+
+	// Use a free voice, or failing that, cut off whichever one started longest ago
+	AudioBackend_Lock();
+
+	for (i = 0; i < SFX_VOICE_COUNT && voice == NULL; ++i)
+		if (sfx_voices[i].stream != NULL && sfx_voices[i].data == NULL)
+			voice = &sfx_voices[i];
+
+	if (voice == NULL)
+		for (i = 0; i < SFX_VOICE_COUNT; ++i)
+			if (sfx_voices[i].stream != NULL && (voice == NULL || voice_start_counter - sfx_voices[i].start_order > voice_start_counter - voice->start_order))
+				voice = &sfx_voices[i];
+
+	// Silence it until it has the effect's volume and panning
+	if (voice != NULL)
+		voice->data = NULL;
+
+	AudioBackend_Unlock();
+
+	if (voice == NULL)
+		return;
+
+	AudioBackend_SetSoundVolume(voice->stream, effect->volume);
+	AudioBackend_SetSoundPan(voice->stream, effect->pan);
 
 	AudioBackend_Lock();
-	ClownAudio_Mixer_SetSoundVolume(mixer, song.sound_id, volume_linear, volume_linear);
+	voice->effect = id;
+	voice->position = 0;
+	voice->position_fraction = 0;
+	voice->step = GetVoiceStep(effect->frequency);
+	voice->loop = loop;
+	voice->start_order = ++voice_start_counter;
+	voice->data = effect->data;
 	AudioBackend_Unlock();
+
+	if (playing)
+		AudioBackend_PlaySound(voice->stream, false);
 }
 
-void ExtraSound_LoadSFX(const char *path, int id)
+// The voices' streams stop by themselves once they find that they have no data
+static void StopVoices(int id)
 {
-	if (sfx_list[id].valid)
-	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_DestroySound(mixer, sfx_list[id].sound_id);
-		AudioBackend_Unlock();
+	AudioBackend_Lock();
 
-		ClownAudio_Mixer_UnloadSoundData(sfx_list[id].sound_data);
-	}
+	for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+		if (sfx_voices[i].effect == id)
+			sfx_voices[i].data = NULL;
 
-	size_t file_buffer_size;
+	AudioBackend_Unlock();
+}
 
-	ClownAudio_SoundDataConfig data_config;
-	ClownAudio_InitSoundDataConfig(&data_config);
-	data_config.predecode = true;
-	data_config.dynamic_sample_rate = true;
-	sfx_list[id].sound_data = ClownAudio_Mixer_LoadSoundDataFromFiles(mixer, path, NULL, &data_config);
+static void FreeSFX(int id)
+{
+	SFXEffect *effect = &sfx_list[id];
 
-	if (sfx_list[id].sound_data != NULL)
-	{
-		ClownAudio_SoundConfig sound_config;
-		ClownAudio_InitSoundConfig(&sound_config);
-		sound_config.do_not_free_when_done = true;
-		sound_config.dynamic_sample_rate = true;
-		ClownAudio_Sound *sound = ClownAudio_Mixer_CreateSound(mixer, sfx_list[id].sound_data, &sound_config);
+	FreeSlot(&effect->streamed);
 
-		if (sound != NULL)
-		{
-			AudioBackend_Lock();
-			sfx_list[id].sound_id = ClownAudio_Mixer_RegisterSound(mixer, sound);
-			AudioBackend_Unlock();
+	if (effect->data != NULL)
+	{
+		StopVoices(id);
+		ReleaseSFXData(effect->data);
+		effect->data = NULL;
+	}
+}
 
-			sfx_list[id].volume = 0;
-			sfx_list[id].pan = 0;
-			sfx_list[id].valid = true;
-			return;
-		}
+// Makes `new_song` the current song, with whatever the game asked of it while it was loading.
+// Called with `load_mutex` held.
+static void InstallSong(SoundSlot *new_song)
+{
+	if (new_song->valid)
+	{
+		if (pending_volume_set)
+			AudioBackend_SetStreamVolume(new_song->stream, pending_volume);
 
-		ClownAudio_Mixer_UnloadSoundData(sfx_list[id].sound_data);
+		new_song->unpaused = pending_unpause;
+		song = *new_song;
+		UpdateStream(&song);
 	}
+}
+
+static bool IsMusicLoadAbandoned(void)
+{
+	Backend_LockMutex(load_mutex);
+	const bool abandoned = load_abandoned;
+	Backend_UnlockMutex(load_mutex);
 
-	sfx_list[id].valid = false;
+	return abandoned;
 }
 
-void ExtraSound_PlaySFX(int id, int mode)
+static void LoadMusicThread(void *user_data)
 {
-	if (sfx_list[id].valid)
+	(void)user_data;
+
+	SoundSlot new_song;
+
+	Backend_LockMutex(load_mutex);
+
+	for (;;)
 	{
-		AudioBackend_Lock();
+		const std::string intro_path = load_intro_path;
+		const std::string loop_path = load_loop_path;
+		const bool loop = load_loop;
+		load_abandoned = false;
 
-		switch (mode)
-		{
-			case 0:
-				ClownAudio_Mixer_PauseSound(mixer, sfx_list[id].sound_id);
-				break;
+		Backend_UnlockMutex(load_mutex);
 
-			case 1:
-				ClownAudio_Mixer_PauseSound(mixer, sfx_list[id].sound_id);
-				ClownAudio_Mixer_RewindSound(mixer, sfx_list[id].sound_id);
-				ClownAudio_Mixer_SetSoundLoop(mixer, sfx_list[id].sound_id, false);
-				ClownAudio_Mixer_UnpauseSound(mixer, sfx_list[id].sound_id);
-				break;
+		new_song.valid = false;
 
-			case -1:
-				ClownAudio_Mixer_SetSoundLoop(mixer, sfx_list[id].sound_id, true);
-				ClownAudio_Mixer_UnpauseSound(mixer, sfx_list[id].sound_id);
-				break;
+		ClownAudio_SoundDataConfig data_config;
+		ClownAudio_InitSoundDataConfig(&data_config);
+		data_config.memory_map = true;	// Songs are streamed, so their files stay loaded for as long as they play
+		ClownAudio_SoundData *sound_data = LoadSoundData(!intro_path.empty() ? intro_path.c_str() : NULL, !loop_path.empty() ? loop_path.c_str() : NULL, &data_config);
+
+		if (sound_data != NULL)
+		{
+			// An abandoned song isn't worth decoding the start of
+			if (IsMusicLoadAbandoned())
+			{
+				ClownAudio_Mixer_UnloadSoundData(sound_data);
+			}
+			else
+			{
+				ClownAudio_SoundConfig sound_config;
+				ClownAudio_InitSoundConfig(&sound_config);
+				sound_config.loop = loop;
+				sound_config.resampler = CLOWNAUDIO_RESAMPLER_SINC;	// Songs are only resampled if they don't match the mixer's sample rate, so they can afford the best quality
+				CreateSlot(&new_song, sound_data, &sound_config, true);
+			}
 		}
 
-		AudioBackend_Unlock();
+		Backend_LockMutex(load_mutex);
+
+		if (!load_abandoned)
+			break;
+
+		// The game wants another song now, which has been left for this worker to load next
+		Backend_UnlockMutex(load_mutex);
+		FreeSlot(&new_song);
+		Backend_LockMutex(load_mutex);
 	}
+
+	// If the game asked for a song that was being prefetched, it's played straight away
+	if (load_pending)
+		InstallSong(&new_song);
+	else
+		prefetched_song = new_song;
+
+	load_pending = false;
+	load_running = false;
+
+	Backend_UnlockMutex(load_mutex);
 }
 
-void ExtraSound_SetSFXFrequency(int id, unsigned long frequency)
+static void JoinLoadThread(void)
 {
-	if (sfx_list[id].valid)
+	if (load_thread != NULL)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_SetSoundSampleRate(mixer, sfx_list[id].sound_id, frequency, frequency);
-		AudioBackend_Unlock();
+		Backend_JoinThread(load_thread);
+		load_thread = NULL;
 	}
 }
 
-void ExtraSound_SetSFXVolume(int id, long volume)
+// Only waits for the song that the game wants - a prefetch is left to carry on
+static void WaitForMusicLoad(void)
 {
-	if (sfx_list[id].valid)
-	{
-		sfx_list[id].volume = volume;
+	Backend_LockMutex(load_mutex);
+	const bool loading_song = load_pending;
+	Backend_UnlockMutex(load_mutex);
 
-		const unsigned short volume_scale = MillibelToScale(sfx_list[id].volume);
-		const unsigned short pan_scale_left = MillibelToScale(-sfx_list[id].pan);
-		const unsigned short pan_scale_right = MillibelToScale(sfx_list[id].pan);
+	if (loading_song)
+		JoinLoadThread();
+}
 
-		AudioBackend_Lock();
-		ClownAudio_Mixer_SetSoundVolume(mixer, sfx_list[id].sound_id, (pan_scale_left * volume_scale) >> 8, (pan_scale_right * volume_scale) >> 8);
-		AudioBackend_Unlock();
-	}
+static bool IsPrefetchedSong(const std::string &intro_path, const std::string &loop_path, bool loop)
+{
+	return intro_path == prefetch_intro_path && loop_path == prefetch_loop_path && loop == prefetch_loop;
 }
 
-void ExtraSound_SetSFXPan(int id, long pan)
+void ExtraSound_Init(unsigned int sample_rate)
 {
-	if (sfx_list[id].valid)
+	// Backends that don't mix in software have no output rate to decode for, and can't play streams anyway
+	if (sample_rate != 0)
+		mixer = ClownAudio_CreateMixer(sample_rate);
+
+	output_sample_rate = sample_rate;
+
+	load_mutex = Backend_CreateMutex();
+
+	load_stats.files = 0;
+	load_stats.probes = 0;
+	load_stats.sniff_misses = 0;
+	load_milliseconds = 0;
+
+	if (mixer != NULL)
 	{
-		sfx_list[id].pan = pan;
+		decode_ring_size = 1;
+		while (decode_ring_size < sample_rate * DECODE_AHEAD_MILLISECONDS / 1000)
+			decode_ring_size <<= 1;
 
-		const unsigned short volume_scale = MillibelToScale(sfx_list[id].volume);
-		const unsigned short pan_scale_left = MillibelToScale(-sfx_list[id].pan);
-		const unsigned short pan_scale_right = MillibelToScale(sfx_list[id].pan);
+		underrun_count = 0;
 
-		AudioBackend_Lock();
-		ClownAudio_Mixer_SetSoundVolume(mixer, sfx_list[id].sound_id, (pan_scale_left * volume_scale) >> 8, (pan_scale_right * volume_scale) >> 8);
-		AudioBackend_Unlock();
+		decode_ahead_mutex = Backend_CreateMutex();
+		ring_mutex = Backend_CreateMutex();
+		decode_ahead_running = true;
+		decode_ahead_thread = Backend_CreateThread(DecodeAheadThread, NULL);
+
+		for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+		{
+			sfx_voices[i].data = NULL;
+			sfx_voices[i].effect = -1;
+			sfx_voices[i].stream = AudioBackend_CreateStream(VoiceCallback, &sfx_voices[i]);
+		}
+
+	#ifdef EXTRA_SOUND_CACHE
+		ExtraSoundCache_Load();
+	#endif
 	}
 }
 
-void ExtraSound_Mix(long *buffer, unsigned long frames)
+void ExtraSound_Deinit(void)
 {
-	if (playing)
+	JoinLoadThread();
+
+	FreeSlot(&prefetched_song);
+	FreeSlot(&previous_song);
+	FreeSlot(&song);
+
+	for (unsigned int i = 0; i < SE_MAX; ++i)
+		FreeSFX(i);
+
+	for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
 	{
-		AudioBackend_Lock();
-		ClownAudio_Mixer_MixSamples(mixer, buffer, frames);
-		AudioBackend_Unlock();
-	}
+		if (sfx_voices[i].stream != NULL)
+		{
+			AudioBackend_DestroySound(sfx_voices[i].stream);
+			sfx_voices[i].stream = NULL;
+		}
+	}
+
+#ifdef EXTRA_SOUND_CACHE
+	// The sound effects are gone now, so nothing is playing out of the cache anymore
+	ExtraSoundCache_Save();
+	ExtraSoundCache_Free();
+#endif
+
+	if (decode_ahead_thread != NULL)
+	{
+		Backend_LockMutex(decode_ahead_mutex);
+		decode_ahead_running = false;
+		Backend_UnlockMutex(decode_ahead_mutex);
+
+		Backend_JoinThread(decode_ahead_thread);
+		decode_ahead_thread = NULL;
+	}
+
+	Backend_DestroyMutex(decode_ahead_mutex);
+	decode_ahead_mutex = NULL;
+	Backend_DestroyMutex(ring_mutex);
+	ring_mutex = NULL;
+
+	if (load_stats.files != 0)
+		Backend_PrintInfo("Loaded %lu sound files in %lums, trying %lu decoders (%lu files weren't recognised by their signature)", load_stats.files, load_milliseconds, load_stats.probes, load_stats.sniff_misses);
+
+	if (mixer != NULL)
+	{
+		ClownAudio_DestroyMixer(mixer);
+		mixer = NULL;
+	}
+
+	Backend_DestroyMutex(load_mutex);
+	load_mutex = NULL;
+}
+
+void ExtraSound_Play(void)
+{
+	playing = true;
+	UpdateAllStreams();
+}
+
+void ExtraSound_Stop(void)
+{
+	playing = false;
+	UpdateAllStreams();
+}
+
+void ExtraSound_LoadMusic(const char *intro_file_path, const char *loop_file_path, bool loop)
+{
+	const std::string intro_path = intro_file_path != NULL ? intro_file_path : "";
+	const std::string loop_path = loop_file_path != NULL ? loop_file_path : "";
+	const bool has_song = mixer != NULL && (intro_file_path != NULL || loop_file_path != NULL);
+
+	// If the worker is prefetching, then it can just be told what to do with the song once it's
+	// done (see below). Anything else that it's doing has to be waited for.
+	Backend_LockMutex(load_mutex);
+	const bool worker_prefetching = has_song && load_running && !load_pending;
+	Backend_UnlockMutex(load_mutex);
+
+	if (!worker_prefetching)
+		JoinLoadThread();
+
+	Backend_LockMutex(load_mutex);
+
+	FreeSlot(&previous_song);
+
+	if (song.valid)
+	{
+		song.unpaused = false;
+		UpdateStream(&song);
+	}
+
+	previous_song = song;
+	song.valid = false;
+
+	pending_volume_set = false;
+	pending_unpause = false;
+
+	bool start_thread = false;
+
+	if (!has_song)
+	{
+		// There's nothing to load, so the old song just stays paused
+	}
+	else if (load_running)
+	{
+		// The worker is still prefetching (it can't be doing anything else now). If it's some other
+		// song, then the worker is left to load this one after it.
+		if (!IsPrefetchedSong(intro_path, loop_path, loop))
+		{
+			load_intro_path = intro_path;
+			load_loop_path = loop_path;
+			load_loop = loop;
+			load_abandoned = true;
+
+			prefetch_intro_path.clear();
+			prefetch_loop_path.clear();
+		}
+
+		load_pending = true;
+	}
+	else if (prefetched_song.valid && IsPrefetchedSong(intro_path, loop_path, loop))
+	{
+		SoundSlot new_song = prefetched_song;
+		prefetched_song.valid = false;
+		InstallSong(&new_song);
+	}
+	else
+	{
+		load_intro_path = intro_path;
+		load_loop_path = loop_path;
+		load_loop = loop;
+		load_pending = true;
+		load_running = true;
+		start_thread = true;
+	}
+
+	Backend_UnlockMutex(load_mutex);
+
+	if (start_thread)
+	{
+		// If the worker was prefetching above, it has finished since, but hasn't been joined yet
+		JoinLoadThread();
+
+		load_thread = Backend_CreateThread(LoadMusicThread, NULL);
+
+		// Without threads, the song has to be loaded right here
+		if (load_thread == NULL)
+			LoadMusicThread(NULL);
+	}
+}
+
+void ExtraSound_PrefetchMusic(const char *intro_file_path, const char *loop_file_path, bool loop)
+{
+	if (mixer == NULL || (intro_file_path == NULL && loop_file_path == NULL))
+		return;
+
+	const std::string intro_path = intro_file_path != NULL ? intro_file_path : "";
+	const std::string loop_path = loop_file_path != NULL ? loop_file_path : "";
+
+	Backend_LockMutex(load_mutex);
+	const bool worker_busy = load_running;
+	const bool already_prefetched = IsPrefetchedSong(intro_path, loop_path, loop) && (prefetched_song.valid || (load_running && !load_pending));
+	Backend_UnlockMutex(load_mutex);
+
+	// Prefetching is only a hint, so it's not worth waiting for the worker over
+	if (worker_busy || already_prefetched)
+		return;
+
+	JoinLoadThread();
+
+	FreeSlot(&prefetched_song);
+
+	prefetch_intro_path = intro_path;
+	prefetch_loop_path = loop_path;
+	prefetch_loop = loop;
+
+	load_intro_path = intro_path;
+	load_loop_path = loop_path;
+	load_loop = loop;
+	load_pending = false;
+	load_running = true;
+
+	// Without threads, there's nothing to be gained from loading the song early
+	load_thread = Backend_CreateThread(LoadMusicThread, NULL);
+
+	if (load_thread == NULL)
+		load_running = false;
+}
+
+void ExtraSound_LoadPreviousMusic(void)
+{
+	WaitForMusicLoad();
+
+	FreeSlot(&song);
+
+	if (previous_song.valid)
+	{
+		song = previous_song;
+		AudioBackend_CancelStreamFade(song.stream);
+	}
+
+	previous_song.valid = false;
+}
+
+void ExtraSound_PauseMusic(void)
+{
+	Backend_LockMutex(load_mutex);
+
+	if (load_pending)
+	{
+		pending_unpause = false;
+	}
+	else if (song.valid)
+	{
+		song.unpaused = false;
+		UpdateStream(&song);
+	}
+
+	Backend_UnlockMutex(load_mutex);
+}
+
+void ExtraSound_UnpauseMusic(void)
+{
+	Backend_LockMutex(load_mutex);
+
+	if (load_pending)
+	{
+		pending_unpause = true;
+	}
+	else if (song.valid)
+	{
+		song.unpaused = true;
+		UpdateStream(&song);
+	}
+
+	Backend_UnlockMutex(load_mutex);
+}
+
+void ExtraSound_FadeOutMusic(void)
+{
+	WaitForMusicLoad();
+
+	if (song.valid)
+		AudioBackend_FadeOutStream(song.stream, 5 * 1000);
+}
+
+void ExtraSound_SetMusicVolume(unsigned short volume)
+{
+	const unsigned short volume_linear = (volume * volume) >> 8;
+
+	Backend_LockMutex(load_mutex);
+
+	if (load_pending)
+	{
+		pending_volume_set = true;
+		pending_volume = volume_linear;
+	}
+	else if (song.valid)
+	{
+		AudioBackend_SetStreamVolume(song.stream, volume_linear);
+	}
+
+	Backend_UnlockMutex(load_mutex);
+}
+
+static ClownAudio_SoundData* LoadSFXSoundData(const char *path)
+{
+	ClownAudio_SoundDataConfig data_config;
+	ClownAudio_InitSoundDataConfig(&data_config);
+	data_config.predecode = true;
+	data_config.dynamic_sample_rate = true;
+	return LoadSoundData(path, NULL, &data_config);
+}
+
+// Formats like trackers can't be predecoded, so they're decoded as they play instead
+static void CreateStreamedSFX(SFXEffect *effect, ClownAudio_SoundData *sound_data)
+{
+	ClownAudio_SoundConfig sound_config;
+	ClownAudio_InitSoundConfig(&sound_config);
+	sound_config.do_not_free_when_done = true;
+	sound_config.dynamic_sample_rate = true;
+	sound_config.resampler = CLOWNAUDIO_RESAMPLER_LINEAR;	// These are resampled the whole time they play, to follow their frequency
+	CreateSlot(&effect->streamed, sound_data, &sound_config, false);
+}
+
+// Runs on the workers. Nothing may change `sfx_data_list` while they're going.
+static void DecodeSFXJob(SFXLoadJob *job, bool share_with_batch)
+{
+	const unsigned long start_ticks = Backend_GetTicks();
+
+	size_t file_size;
+	unsigned char *file_buffer = LoadFileToMemory(job->path, &file_size);
+
+	if (file_buffer != NULL)
+	{
+		HashFile(file_buffer, file_size, &job->hash_low, &job->hash_high);
+		free(file_buffer);
+
+		job->file_size = file_size;
+		job->loaded = true;
+
+		// Mods often use the same file for several sound effects, so they're only decoded once
+		Backend_LockMutex(sfx_load_mutex);
+
+		for (SFXData *data = sfx_data_list; data != NULL && job->existing_data == NULL; data = data->next)
+			if (data->hash_low == job->hash_low && data->hash_high == job->hash_high && data->file_size == job->file_size)
+				job->existing_data = data;
+
+		for (size_t i = 0; i < total_sfx_load_jobs && share_with_batch && job->existing_data == NULL && !job->shares_sound; ++i)
+		{
+			const SFXLoadJob *other_job = &sfx_load_jobs[i];
+
+			if (other_job->decoding && other_job->hash_low == job->hash_low && other_job->hash_high == job->hash_high && other_job->file_size == job->file_size)
+				job->shares_sound = true;
+		}
+
+		job->decoding = job->existing_data == NULL && !job->shares_sound;
+
+		Backend_UnlockMutex(sfx_load_mutex);
+	}
+
+	if (job->decoding)
+	{
+	#ifdef EXTRA_SOUND_CACHE
+		// The sound is kept at its own sample rate, and clownaudio always predecodes to stereo
+		ExtraSoundCacheKey cache_key;
+		cache_key.hash_low = job->hash_low;
+		cache_key.hash_high = job->hash_high;
+		cache_key.file_size = (unsigned long)job->file_size;
+		cache_key.wanted_sample_rate = 0;
+		cache_key.channel_count = 2;
+
+		// The cache's samples stay around until ExtraSound_Deinit, so they can be played from where they are
+		job->samples = ExtraSoundCache_Find(&cache_key, &job->frames, &job->sample_rate);
+	#endif
+
+		if (job->samples == NULL)
+		{
+			job->sound_data = LoadSFXSoundData(job->path);
+
+			if (job->sound_data != NULL && (!ClownAudio_SoundData_GetPCM(job->sound_data, &job->samples, &job->frames, &job->sample_rate) || job->frames == 0))
+				job->samples = NULL;
+
+		#ifdef EXTRA_SOUND_CACHE
+			if (job->samples != NULL)
+				ExtraSoundCache_Add(&cache_key, job->samples, job->frames, job->sample_rate);
+		#endif
+		}
+	}
+
+	job->milliseconds = Backend_GetTicks() - start_ticks;
+}
+
+static void SFXLoadWorker(void *user_data)
+{
+	(void)user_data;
+
+	for (;;)
+	{
+		Backend_LockMutex(sfx_load_mutex);
+		const size_t i = sfx_load_next_job++;
+		Backend_UnlockMutex(sfx_load_mutex);
+
+		if (i >= total_sfx_load_jobs)
+			break;
+
+		DecodeSFXJob(&sfx_load_jobs[i], true);
+	}
+}
+
+// Runs on the thread that asked for the sounds, once the workers are done
+static void InstallSFXJob(SFXLoadJob *job)
+{
+	SFXEffect *effect = &sfx_list[job->id];
+
+	// The same slot might be loaded twice in one batch
+	FreeSFX(job->id);
+
+	if (job->shares_sound)
+	{
+		// The job that decoded the file has been installed by now, unless it was streamed, which can't be shared
+		for (SFXData *data = sfx_data_list; data != NULL && job->existing_data == NULL; data = data->next)
+			if (data->hash_low == job->hash_low && data->hash_high == job->hash_high && data->file_size == job->file_size)
+				job->existing_data = data;
+
+		if (job->existing_data == NULL)
+		{
+			job->shares_sound = false;
+			DecodeSFXJob(job, false);
+		}
+	}
+
+	if (job->existing_data != NULL)
+	{
+		++job->existing_data->reference_count;
+		effect->data = job->existing_data;
+	}
+	else if (job->samples != NULL)
+	{
+		effect->data = CreateSFXData(job->sound_data, job->samples, job->frames, job->sample_rate, job->hash_low, job->hash_high, job->file_size);
+	}
+	else if (job->sound_data != NULL)
+	{
+		CreateStreamedSFX(effect, job->sound_data);
+	}
+
+	if (effect->data != NULL)
+	{
+		effect->frequency = effect->data->sample_rate;
+		effect->volume = 0;
+		effect->pan = 0;
+	}
+}
+
+// Returns how many threads did the loading
+static unsigned int LoadSFXJobs(SFXLoadJob *jobs, size_t total_jobs)
+{
+	Backend_Thread *workers[SFX_LOAD_WORKERS - 1];
+	unsigned int threads_used = 1;
+	size_t i;
+
+	// Nothing gets shared with the sounds that are about to be replaced
+	for (i = 0; i < total_jobs; ++i)
+		FreeSFX(jobs[i].id);
+
+	if (mixer == NULL)
+		return 0;
+
+	for (i = 0; i < total_jobs; ++i)
+	{
+		jobs[i].loaded = false;
+		jobs[i].existing_data = NULL;
+		jobs[i].decoding = false;
+		jobs[i].shares_sound = false;
+		jobs[i].sound_data = NULL;
+		jobs[i].samples = NULL;
+		jobs[i].milliseconds = 0;
+	}
+
+	sfx_load_jobs = jobs;
+	total_sfx_load_jobs = total_jobs;
+	sfx_load_next_job = 0;
+	sfx_load_mutex = Backend_CreateMutex();
+
+	// This thread does its share of the work too. Without threads, it does all of it.
+	for (i = 0; i < SFX_LOAD_WORKERS - 1; ++i)
+		workers[i] = i + 1 < total_jobs ? Backend_CreateThread(SFXLoadWorker, NULL) : NULL;
+
+	SFXLoadWorker(NULL);
+
+	for (i = 0; i < SFX_LOAD_WORKERS - 1; ++i)
+	{
+		if (workers[i] != NULL)
+		{
+			Backend_JoinThread(workers[i]);
+			++threads_used;
+		}
+	}
+
+	// The sounds that were decoded go first, so that the ones sharing them can find them
+	for (i = 0; i < total_jobs; ++i)
+		if (!jobs[i].shares_sound)
+			InstallSFXJob(&jobs[i]);
+
+	for (i = 0; i < total_jobs; ++i)
+		if (jobs[i].shares_sound)
+			InstallSFXJob(&jobs[i]);
+
+	Backend_DestroyMutex(sfx_load_mutex);
+	sfx_load_mutex = NULL;
+
+	sfx_load_jobs = NULL;
+	total_sfx_load_jobs = 0;
+
+	return threads_used;
+}
+
+void ExtraSound_LoadSFX(const char *path, int id)
+{
+	SFXLoadJob job;
+	job.path = path;
+	job.id = id;
+
+	LoadSFXJobs(&job, 1);
+}
+
+void ExtraSound_LoadSFXList(const char *const *paths, const int *ids, size_t total_sounds)
+{
+	SFXLoadJob *jobs = (SFXLoadJob*)malloc(total_sounds * sizeof(SFXLoadJob));
+
+	if (jobs == NULL)
+	{
+		for (size_t i = 0; i < total_sounds; ++i)
+			ExtraSound_LoadSFX(paths[i], ids[i]);
+
+		return;
+	}
+
+	for (size_t i = 0; i < total_sounds; ++i)
+	{
+		jobs[i].path = paths[i];
+		jobs[i].id = ids[i];
+	}
+
+	const unsigned long start_ticks = Backend_GetTicks();
+	const unsigned int threads_used = LoadSFXJobs(jobs, total_sounds);
+	const unsigned long ticks_taken = Backend_GetTicks() - start_ticks;
+
+	if (threads_used != 0)
+	{
+		unsigned long serial_ticks = 0;
+
+		for (size_t i = 0; i < total_sounds; ++i)
+		{
+			if (!jobs[i].loaded)
+				Backend_PrintInfo("Sound effect %s couldn't be loaded", jobs[i].path);
+			else if (jobs[i].decoding && jobs[i].samples == NULL && jobs[i].sound_data == NULL)
+				Backend_PrintInfo("Sound effect %s couldn't be decoded", jobs[i].path);
+			else if (jobs[i].decoding)
+				Backend_PrintInfo("Sound effect %s took %lums", jobs[i].path, jobs[i].milliseconds);
+
+			serial_ticks += jobs[i].milliseconds;
+		}
+
+		Backend_PrintInfo("Loading %lu sound effects took %lums (%lums of work across %u threads)", (unsigned long)total_sounds, ticks_taken, serial_ticks, threads_used);
+	}
+
+	free(jobs);
+}
+
+static void PlayStreamedSFX(SoundSlot *slot, int mode)
+{
+	switch (mode)
+	{
+		case 0:
+			slot->unpaused = false;
+			break;
+
+		case 1:
+			AudioBackend_Lock();
+			ClownAudio_Mixer_RewindSound(mixer, slot->sound_id);
+			ClownAudio_Mixer_SetSoundLoop(mixer, slot->sound_id, false);
+			AudioBackend_Unlock();
+			slot->unpaused = true;
+			break;
+
+		case -1:
+			AudioBackend_Lock();
+			ClownAudio_Mixer_SetSoundLoop(mixer, slot->sound_id, true);
+			AudioBackend_Unlock();
+			slot->unpaused = true;
+			break;
+	}
+
+	UpdateStream(slot);
+}
+
+void ExtraSound_PlaySFX(int id, int mode)
+{
+	if (sfx_list[id].streamed.valid)
+	{
+		PlayStreamedSFX(&sfx_list[id].streamed, mode);
+		return;
+	}
+
+	if (sfx_list[id].data == NULL)
+		return;
+
+	switch (mode)
+	{
+		case 0:
+			StopVoices(id);
+			break;
+
+		case 1:
+			// Unlike the game's own sounds, these layer on top of the ones that are already playing
+			StartVoice(id, false);
+			break;
+
+		case -1:
+		{
+			// Like the game's own sounds, this makes the sound loop if it's already playing
+			SFXVoice *newest_voice = NULL;
+
+			AudioBackend_Lock();
+
+			for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+				if (sfx_voices[i].effect == id && sfx_voices[i].data != NULL && (newest_voice == NULL || voice_start_counter - sfx_voices[i].start_order < voice_start_counter - newest_voice->start_order))
+					newest_voice = &sfx_voices[i];
+
+			if (newest_voice != NULL)
+				newest_voice->loop = true;
+
+			AudioBackend_Unlock();
+
+			if (newest_voice == NULL)
+				StartVoice(id, true);
+
+			break;
+		}
+	}
+}
+
+void ExtraSound_SetSFXFrequency(int id, unsigned long frequency)
+{
+	if (sfx_list[id].streamed.valid)
+	{
+		AudioBackend_Lock();
+		ClownAudio_Mixer_SetSoundSampleRate(mixer, sfx_list[id].streamed.sound_id, frequency, frequency);
+		AudioBackend_Unlock();
+	}
+	else if (sfx_list[id].data != NULL)
+	{
+		sfx_list[id].frequency = frequency;
+
+		AudioBackend_Lock();
+
+		for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+			if (sfx_voices[i].effect == id)
+				sfx_voices[i].step = GetVoiceStep(frequency);
+
+		AudioBackend_Unlock();
+	}
+}
+
+// A voice's effect only changes on this thread, so it can be checked without locking the backend.
+// Voices that have finished can be changed too, since they get set up again when they're reused.
+void ExtraSound_SetSFXVolume(int id, long volume)
+{
+	if (sfx_list[id].streamed.valid)
+	{
+		AudioBackend_SetSoundVolume(sfx_list[id].streamed.stream, volume);
+	}
+	else if (sfx_list[id].data != NULL)
+	{
+		sfx_list[id].volume = volume;
+
+		for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+			if (sfx_voices[i].effect == id)
+				AudioBackend_SetSoundVolume(sfx_voices[i].stream, volume);
+	}
+}
+
+void ExtraSound_SetSFXPan(int id, long pan)
+{
+	if (sfx_list[id].streamed.valid)
+	{
+		AudioBackend_SetSoundPan(sfx_list[id].streamed.stream, pan);
+	}
+	else if (sfx_list[id].data != NULL)
+	{
+		sfx_list[id].pan = pan;
+
+		for (unsigned int i = 0; i < SFX_VOICE_COUNT; ++i)
+			if (sfx_voices[i].effect == id)
+				AudioBackend_SetSoundPan(sfx_voices[i].stream, pan);
+	}
+}
+
+unsigned long ExtraSound_GetUnderrunCount(void)
+{
+	Backend_LockMutex(ring_mutex);
+	const unsigned long count = underrun_count;
+	Backend_UnlockMutex(ring_mutex);
+
+	return count;
 }
@@ -1,18 +1,22 @@
 #pragma once
 
-void ExtraSound_Init(unsigned int sample_rate);
+#include <stddef.h>
+
+void ExtraSound_Init(unsigned int sample_rate);	// Call after the audio backend has been initialised, with its output rate
 void ExtraSound_Deinit(void);
 void ExtraSound_Play(void);
 void ExtraSound_Stop(void);
 void ExtraSound_LoadMusic(const char *intro_file_path, const char *loop_file_path, bool loop);
+void ExtraSound_PrefetchMusic(const char *intro_file_path, const char *loop_file_path, bool loop);	// Loads a song ahead of time, so that ExtraSound_LoadMusic can start it straight away
 void ExtraSound_LoadPreviousMusic(void);
 void ExtraSound_PauseMusic(void);
 void ExtraSound_UnpauseMusic(void);
 void ExtraSound_FadeOutMusic(void);
 void ExtraSound_SetMusicVolume(unsigned short volume);	// Logarithmic - 0 is silent, 0x80 is half-volume, 0x100 is full-volume
 void ExtraSound_LoadSFX(const char *path, int id);
+void ExtraSound_LoadSFXList(const char *const *paths, const int *ids, size_t total_sounds);	// Like calling ExtraSound_LoadSFX for each sound, but they're decoded in parallel
 void ExtraSound_PlaySFX(int id, int mode);
 void ExtraSound_SetSFXFrequency(int id, unsigned long frequency);
 void ExtraSound_SetSFXVolume(int id, long volume);
 void ExtraSound_SetSFXPan(int id, long pan);
-void ExtraSound_Mix(long *buffer, unsigned long frames);
+unsigned long ExtraSound_GetUnderrunCount(void);	// How many times the music decoder has fallen behind the audio callback
@@ -9,18 +9,26 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 
 #include "WindowsWrapper.h"
 
+#include "Backends/Misc.h"
 #include "CommonDefines.h"
 #include "Draw.h"
 #include "Ending.h"
 #ifdef EXTRA_SOUND_FORMATS
 #include "ExtraSoundFormats.h"
 #endif
+#ifdef EXTRA_SOUND_CACHE
+#include "ExtraSoundCache.h"
+#endif
 #include "Main.h"
 #include "PixTone.h"
+#ifdef PIXTONE_CACHE
+#include "PixToneCache.h"
+#endif
 #include "Sound.h"
 
 enum
@@ -124,83 +132,76 @@ static const struct
 	{155, "PixTone/155.pxt", SOUND_TYPE_PIXTONE}
 };
 
-// Original decompiled from `PTone103.exe` - has since been modified
-static BOOL LoadPixToneFile(const char *filename, PIXTONEPARAMETER *pixtone_parameters)
+// PixTone synthesis takes long enough to be noticeable at startup, so it's spread across a
+// few worker threads. Only registering the sounds with the audio backend is left to the
+// main thread, since the backends aren't thread-safe.
+#define PIXTONE_WORKERS 4
+
+typedef struct PIXTONERESULT
 {
-	BOOL success = FALSE;
+	unsigned char *data;	// NULL if the file couldn't be loaded or synthesised
+	int sample_count;
+} PIXTONERESULT;
+
+static PIXTONERESULT pixtone_results[sizeof(ptp_table) / sizeof(ptp_table[0])];
+static unsigned int pixtone_next_job;
+static Backend_Mutex *pixtone_mutex;
 
-	FILE *fp = fopen(filename, "r");
+static void PixToneWorker(void *user_data)
+{
+	(void)user_data;
 
-	if (fp != NULL)
+	for (;;)
 	{
-		fseek(fp, 0, SEEK_END);
-		const size_t file_size = ftell(fp);
-		rewind(fp);
+		Backend_LockMutex(pixtone_mutex);
+		const unsigned int i = pixtone_next_job++;
+		Backend_UnlockMutex(pixtone_mutex);
+
+		if (i >= sizeof(ptp_table) / sizeof(ptp_table[0]))
+			break;
 
-		char *file_buffer = (char*)malloc(file_size);
-		fread(file_buffer, 1, file_size, fp);
+		if (ptp_table[i].type != SOUND_TYPE_PIXTONE)
+			continue;
 
-		fclose(fp);
+		std::string path = gDataPath + '/' + ptp_table[i].path;
 
-		char *p = file_buffer;
+		PIXTONEPARAMETER pixtone_parameters[4];
 
-		for (unsigned int i = 0; i < 4; ++i)
+		if (LoadPixToneFile(path.c_str(), pixtone_parameters))
 		{
-			float freq;
-			int increment;
-			sscanf(p, "use  :%d\n%n", &pixtone_parameters[i].use, &increment);
-			p += increment;
-			sscanf(p, "size :%d\n%n", &pixtone_parameters[i].size, &increment);
-			p += increment;
-			sscanf(p, "main_model   :%d\n%n", &pixtone_parameters[i].oMain.model, &increment);
-			p += increment;
-			sscanf(p, "main_freq    :%f\n%n", &freq, &increment);
-			p += increment;
-			pixtone_parameters[i].oMain.num = freq;
-			sscanf(p, "main_top     :%d\n%n", &pixtone_parameters[i].oMain.top, &increment);
-			p += increment;
-			sscanf(p, "main_offset  :%d\n%n", &pixtone_parameters[i].oMain.offset, &increment);
-			p += increment;
-			sscanf(p, "pitch_model  :%d\n%n", &pixtone_parameters[i].oPitch.model, &increment);
-			p += increment;
-			sscanf(p, "pitch_freq   :%f\n%n", &freq, &increment);
-			p += increment;
-			pixtone_parameters[i].oPitch.num = freq;
-			sscanf(p, "pitch_top    :%d\n%n", &pixtone_parameters[i].oPitch.top, &increment);
-			p += increment;
-			sscanf(p, "pitch_offset :%d\n%n", &pixtone_parameters[i].oPitch.offset, &increment);
-			p += increment;
-			sscanf(p, "volume_model :%d\n%n", &pixtone_parameters[i].oVolume.model, &increment);
-			p += increment;
-			sscanf(p, "volume_freq  :%f\n%n", &freq, &increment);
-			p += increment;
-			pixtone_parameters[i].oVolume.num = freq;
-			sscanf(p, "volume_top   :%d\n%n", &pixtone_parameters[i].oVolume.top, &increment);
-			p += increment;
-			sscanf(p, "volume_offset:%d\n%n", &pixtone_parameters[i].oVolume.offset, &increment);
-			p += increment;
-			sscanf(p, "initialY:%d\n%n", &pixtone_parameters[i].initial, &increment);
-			p += increment;
-			sscanf(p, "ax      :%d\n%n", &pixtone_parameters[i].pointAx, &increment);
-			p += increment;
-			sscanf(p, "ay      :%d\n%n", &pixtone_parameters[i].pointAy, &increment);
-			p += increment;
-			sscanf(p, "bx      :%d\n%n", &pixtone_parameters[i].pointBx, &increment);
-			p += increment;
-			sscanf(p, "by      :%d\n%n", &pixtone_parameters[i].pointBy, &increment);
-			p += increment;
-			sscanf(p, "cx      :%d\n%n", &pixtone_parameters[i].pointCx, &increment);
-			p += increment;
-			sscanf(p, "cy      :%d\n\n%n", &pixtone_parameters[i].pointCy, &increment);
-			p += increment;
+			int ptp_num = 0;
+			while (pixtone_parameters[ptp_num].use && ptp_num < 4)
+				++ptp_num;
+
+			pixtone_results[i].data = MakePixToneData(pixtone_parameters, ptp_num, &pixtone_results[i].sample_count);
 		}
+	}
+}
 
-		free(file_buffer);
+static void MakePixToneData_Parallel(void)
+{
+	Backend_Thread *workers[PIXTONE_WORKERS - 1];
+	int i;
 
-		success = TRUE;
-	}
+	// The wave tables are shared by every worker, so make them beforehand
+	InitWaveTables();
+
+	memset(pixtone_results, 0, sizeof(pixtone_results));
+	pixtone_next_job = 0;
+	pixtone_mutex = Backend_CreateMutex();
+
+	// This thread does its share of the work too. Without threads, it does all of it.
+	for (i = 0; i < PIXTONE_WORKERS - 1; ++i)
+		workers[i] = Backend_CreateThread(PixToneWorker, NULL);
+
+	PixToneWorker(NULL);
+
+	for (i = 0; i < PIXTONE_WORKERS - 1; ++i)
+		if (workers[i] != NULL)
+			Backend_JoinThread(workers[i]);
 
-	return success;
+	Backend_DestroyMutex(pixtone_mutex);
+	pixtone_mutex = NULL;
 }
 
 BOOL LoadGenericData(void)
@@ -256,34 +257,62 @@ BOOL LoadGenericData(void)
 
 	pt_size = 0;
 
-	for (unsigned int i = 0; i < sizeof(ptp_table) / sizeof(ptp_table[0]); ++i)
+	// Without audio, the sounds would just be thrown away
+	if (audio_backend_initialised)
 	{
-		std::string path = gDataPath + '/' + ptp_table[i].path;
+		const unsigned long start_ticks = Backend_GetTicks();
+		MakePixToneData_Parallel();
+		Backend_PrintInfo("PixTone synthesis took %lums", Backend_GetTicks() - start_ticks);
+	}
+
+#ifdef EXTRA_SOUND_FORMATS
+	// Replacement sound effects are decoded in parallel, so they're gathered up first
+	std::string other_paths[sizeof(ptp_table) / sizeof(ptp_table[0])];
+	const char *other_path_pointers[sizeof(ptp_table) / sizeof(ptp_table[0])];
+	int other_slots[sizeof(ptp_table) / sizeof(ptp_table[0])];
+	size_t total_others = 0;
+#endif
 
+	for (unsigned int i = 0; i < sizeof(ptp_table) / sizeof(ptp_table[0]); ++i)
+	{
 		switch (ptp_table[i].type)
 		{
 			case SOUND_TYPE_PIXTONE:
-				PIXTONEPARAMETER pixtone_parameters[4];
-
-				if (LoadPixToneFile(path.c_str(), pixtone_parameters))
+				if (pixtone_results[i].data != NULL)
 				{
-					int ptp_num = 0;
-					while (pixtone_parameters[ptp_num].use && ptp_num < 4)
-						++ptp_num;
-
-					pt_size += MakePixToneObject(pixtone_parameters, ptp_num, ptp_table[i].slot);
+					pt_size += MakePixToneObjectFromData(pixtone_results[i].data, pixtone_results[i].sample_count, ptp_table[i].slot);
+					free(pixtone_results[i].data);
+					pixtone_results[i].data = NULL;
 				}
 
 				break;
 
 #ifdef EXTRA_SOUND_FORMATS
 			case SOUND_TYPE_OTHER:
-				ExtraSound_LoadSFX(path.c_str(), ptp_table[i].slot);
+				other_paths[total_others] = gDataPath + '/' + ptp_table[i].path;
+				other_path_pointers[total_others] = other_paths[total_others].c_str();
+				other_slots[total_others] = ptp_table[i].slot;
+				++total_others;
 				break;
 #endif
 		}
 	}
 
+#ifdef EXTRA_SOUND_FORMATS
+	if (total_others != 0)
+		ExtraSound_LoadSFXList(other_path_pointers, other_slots, total_others);
+#endif
+
+#ifdef PIXTONE_CACHE
+	// Save now rather than on exit, in case the game doesn't get to exit cleanly
+	if (audio_backend_initialised)
+		PixToneCache_Save();
+#endif
+#ifdef EXTRA_SOUND_CACHE
+	if (audio_backend_initialised)
+		ExtraSoundCache_Save();
+#endif
+
 	// Commented-out, since ints *technically* have an undefined length
 /*
 	char str[0x40];
@@ -235,7 +235,8 @@ int main(int argc, char *argv[])
 	}
 
 	// Initialize sound
-	InitDirectSound();
+	InitDirectSound(conf.audio_frequency, conf.audio_period);
+	SetSoundVoiceLimit(conf.voice_limit);
 
 	// Initialize joystick
 	InitDirectInput();
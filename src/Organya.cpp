@@ -13,6 +13,7 @@
 
 #include "Organya.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,6 +26,9 @@
 #include "Backends/Misc.h"
 #include "File.h"
 #include "Main.h"
+#ifdef ORGANYA_PRERENDER
+#include "OrganyaStream.h"
+#endif
 #include "Sound.h"
 
 #define PANDUMMY 0xFF
@@ -47,17 +51,6 @@
 #define SETPIPI		0x00000040
 
 // Below are Organya song data structures
-typedef struct NOTELIST
-{
-	NOTELIST *from;	// Previous address
-	NOTELIST *to;	// Next address
-
-	long x;	// Position
-	unsigned char length;	// Sound length
-	unsigned char y;	// Sound height
-	unsigned char volume;	// Volume
-	unsigned char pan;
-} NOTELIST;
 
 // Track data * 8
 typedef struct TRACKDATA
@@ -66,8 +59,14 @@ typedef struct TRACKDATA
 	unsigned char wave_no;	// Waveform No.
 	signed char pipi;
 
-	NOTELIST *note_p;
-	NOTELIST *note_list;
+	// The notes are stored in order of position, with an array for each of their fields.
+	// They all share a single allocation, which note_x points to the start of.
+	unsigned short note_num;	// Number of notes
+	long *note_x;	// Position
+	unsigned char *note_y;	// Sound height
+	unsigned char *note_length;	// Sound length
+	unsigned char *note_volume;	// Volume
+	unsigned char *note_pan;
 } TRACKDATA;
 
 // Unique information held in songs
@@ -107,6 +106,65 @@ typedef struct OrgData
 
 AudioBackend_Sound *lpORGANBUFFER[8][8][2] = {NULL};
 
+// The last values sent to the audio backend, so that redundant updates can be skipped
+#define PARAMETER_UNKNOWN LONG_MIN
+
+static long organ_volume_cache[8][8][2];
+static long organ_pan_cache[8][8][2];
+static long organ_frequency_cache[8];
+
+static AudioBackend_Sound *dram_cache_sound[MAXDRAM];
+static long dram_volume_cache[MAXDRAM];
+static long dram_pan_cache[MAXDRAM];
+static long dram_frequency_cache[MAXDRAM];
+
+#ifdef ORGANYA_PRERENDER
+// Once a song's instruments have been rendered (see OrganyaStream.h), the render is streamed in
+// place of them. Organya still plays the song, just without the instruments' notes, so that the
+// drums and everything else carry on as usual.
+static BOOL streaming;
+static BOOL looped;	// Whether the song has gone back to its loop point since it was started or moved
+#else
+static const BOOL streaming = FALSE;
+#endif
+
+static void ResetOrganCache(signed char track)
+{
+	for (int j = 0; j < 8; j++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			organ_volume_cache[track][j][k] = PARAMETER_UNKNOWN;
+			organ_pan_cache[track][j][k] = PARAMETER_UNKNOWN;
+		}
+	}
+
+	organ_frequency_cache[track] = PARAMETER_UNKNOWN;
+}
+
+static void ResetDramCache(void)
+{
+	for (int i = 0; i < MAXDRAM; i++)
+	{
+		dram_cache_sound[i] = NULL;
+		dram_volume_cache[i] = PARAMETER_UNKNOWN;
+		dram_pan_cache[i] = PARAMETER_UNKNOWN;
+		dram_frequency_cache[i] = PARAMETER_UNKNOWN;
+	}
+}
+
+// The drums are regular sound effects, which can be replaced behind Organya's back
+static void ValidateDramCache(signed char track)
+{
+	if (dram_cache_sound[track] != lpSECONDARYBUFFER[150 + track])
+	{
+		dram_cache_sound[track] = lpSECONDARYBUFFER[150 + track];
+		dram_volume_cache[track] = PARAMETER_UNKNOWN;
+		dram_pan_cache[track] = PARAMETER_UNKNOWN;
+		dram_frequency_cache[track] = PARAMETER_UNKNOWN;
+	}
+}
+
 /////////////////////////////////////////////
 //■オルガーニャ■■■■■■■■■■■■/////// (Organya)
 /////////////////////
@@ -131,7 +189,22 @@ OCTWAVE oct_wave[8] =
 	{   8,128, 32 }, // 7 Oct
 };
 
-BOOL MakeSoundObject8(signed char *wavep, signed char track, signed char pipi)
+// 波形データ (Waveform data)
+signed char wave_data[100][0x100];
+
+// The instruments' waveforms are only made once, and are shared by every track and song that
+// uses them. Each track plays its own duplicates of them, so that they can still be played,
+// pitched and panned independently.
+typedef struct ORGANWAVE
+{
+	AudioBackend_Sound *sound;	// Only ever duplicated, never played
+	unsigned int users;	// How many duplicates of it exist
+} ORGANWAVE;
+
+static ORGANWAVE organ_wave[100][2][8];	// Waveform No., pipi, octave
+static ORGANWAVE *organ_wave_used[MAXMELODY][8];	// Which of them lpORGANBUFFER was duplicated from
+
+BOOL MakeSoundObject8(unsigned char wave_no, AudioBackend_Sound *buffer[8][2], ORGANWAVE *used[8], signed char pipi)
 {
 	unsigned long i,j,k;
 	unsigned long wav_tp;	// WAVテーブルをさすポインタ (Pointer to WAV table)
@@ -140,13 +213,16 @@ BOOL MakeSoundObject8(signed char *wavep, signed char track, signed char pipi)
 	unsigned char *wp;
 	unsigned char *wp_sub;
 	int work;
+	const signed char *wavep = wave_data[wave_no];
 
 	if (!audio_backend_initialised)
 		return FALSE;
 
 	for (j = 0; j < 8; j++)
 	{
-		for (k = 0; k < 2; k++)
+		ORGANWAVE *wave = &organ_wave[wave_no][pipi != 0][j];
+
+		if (wave->sound == NULL)
 		{
 			wave_size = oct_wave[j].wave_size;
 
@@ -178,14 +254,28 @@ BOOL MakeSoundObject8(signed char *wavep, signed char track, signed char pipi)
 				wp_sub++;
 			}
 
-			lpORGANBUFFER[track][j][k] = AudioBackend_CreateSound(22050, wp, data_size);
+			wave->sound = AudioBackend_CreateSound(22050, wp, data_size);
 
 			free(wp);
 
-			if (lpORGANBUFFER[track][j][k] == NULL)
+			if (wave->sound == NULL)
+				return FALSE;
+		}
+
+		used[j] = wave;
+
+		for (k = 0; k < 2; k++)
+		{
+			buffer[j][k] = AudioBackend_DuplicateSound(wave->sound);
+
+			if (buffer[j][k] == NULL)
 				return FALSE;
 
-			AudioBackend_RewindSound(lpORGANBUFFER[track][j][k]);
+			++wave->users;
+
+			AudioBackend_SetSoundPriority(buffer[j][k], AUDIOBACKEND_PRIORITY_MUSIC);
+
+			AudioBackend_RewindSound(buffer[j][k]);
 		}
 	}
 
@@ -199,9 +289,17 @@ void ChangeOrganFrequency(unsigned char key, signed char track, long a)
 	if (!audio_backend_initialised)
 		return;
 
+	// The frequencies only depend on the key and the track's frequency offset
+	const long frequency_id = (a << 4) | key;
+
+	if (organ_frequency_cache[track] == frequency_id)
+		return;
+
+	organ_frequency_cache[track] = frequency_id;
+
 	for (int j = 0; j < 8; j++)
 		for (int i = 0; i < 2; i++)
-			AudioBackend_SetSoundFrequency(lpORGANBUFFER[track][j][i], ((oct_wave[j].wave_size * freq_tbl[key]) * oct_wave[j].oct_par) / 8 + (a - 1000));	// 1000を+αのデフォルト値とする (1000 is the default value for + α)
+			AudioBackend_BatchSoundFrequency(lpORGANBUFFER[track][j][i], ((oct_wave[j].wave_size * freq_tbl[key]) * oct_wave[j].oct_par) / 8 + (a - 1000));	// 1000を+αのデフォルト値とする (1000 is the default value for + α)
 }
 
 BOOL g_mute[MAXTRACK];	// Used by the debug Mute menu
@@ -216,7 +314,16 @@ void ChangeOrganPan(unsigned char key, unsigned char pan, signed char track)	//
 		return;
 
 	if (old_key[track] != KEYDUMMY)
-		AudioBackend_SetSoundPan(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], (pan_tbl[pan] - 0x100) * 10);
+	{
+		long *cache = &organ_pan_cache[track][old_key[track] / 12][key_twin[track]];
+		const long new_pan = (pan_tbl[pan] - 0x100) * 10;
+
+		if (*cache != new_pan)
+		{
+			*cache = new_pan;
+			AudioBackend_BatchSoundPan(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], new_pan);
+		}
+	}
 }
 
 void ChangeOrganVolume(int no, long volume, signed char track)	// 300がMAXで300がﾉｰﾏﾙ (300 is MAX and 300 is normal)
@@ -225,7 +332,16 @@ void ChangeOrganVolume(int no, long volume, signed char track)	// 300がMAXで30
 		return;
 
 	if (old_key[track] != KEYDUMMY)
-		AudioBackend_SetSoundVolume(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], (volume - 0xFF) * 8);
+	{
+		long *cache = &organ_volume_cache[track][old_key[track] / 12][key_twin[track]];
+		const long new_volume = (volume - 0xFF) * 8;
+
+		if (*cache != new_volume)
+		{
+			*cache = new_volume;
+			AudioBackend_BatchSoundVolume(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], new_volume);
+		}
+	}
 }
 
 // サウンドの再生 (Play sound)
@@ -241,8 +357,8 @@ void PlayOrganObject(unsigned char key, int mode, signed char track, long freq)
 			case 0:	// 停止 (Stop)
 				if (old_key[track] != 0xFF)
 				{
-					AudioBackend_StopSound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]]);
-					AudioBackend_RewindSound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]]);
+					AudioBackend_BatchStopSound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]]);
+					AudioBackend_BatchRewindSound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]]);
 				}
 				break;
 
@@ -252,7 +368,7 @@ void PlayOrganObject(unsigned char key, int mode, signed char track, long freq)
 			case 2:	// 歩かせ停止 (Stop playback)
 				if (old_key[track] != 0xFF)
 				{
-					AudioBackend_PlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);
 					old_key[track] = 0xFF;
 				}
 				break;
@@ -261,27 +377,27 @@ void PlayOrganObject(unsigned char key, int mode, signed char track, long freq)
 				if (old_key[track] == 0xFF)	// 新規鳴らす (New sound)
 				{
 					ChangeOrganFrequency(key % 12, track, freq);	// 周波数を設定して (Set the frequency)
-					AudioBackend_PlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
 					old_key[track] = key;
 					key_on[track] = 1;
 				}
 				else if (key_on[track] == 1 && old_key[track] == key)	// 同じ音 (Same sound)
 				{
 					// 今なっているのを歩かせ停止 (Stop playback now)
-					AudioBackend_PlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);
 					key_twin[track]++;
 					if (key_twin[track] > 1)
 						key_twin[track] = 0;
-					AudioBackend_PlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
 				}
 				else	// 違う音を鳴らすなら (If you make a different sound)
 				{
-					AudioBackend_PlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);	// 今なっているのを歩かせ停止 (Stop playback now)
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][old_key[track] / 12][key_twin[track]], FALSE);	// 今なっているのを歩かせ停止 (Stop playback now)
 					key_twin[track]++;
 					if (key_twin[track] > 1)
 						key_twin[track] = 0;
 					ChangeOrganFrequency(key % 12, track, freq);	// 周波数を設定して (Set the frequency)
-					AudioBackend_PlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
+					AudioBackend_BatchPlaySound(lpORGANBUFFER[track][key / 12][key_twin[track]], TRUE);
 					old_key[track] = key;
 				}
 
@@ -290,30 +406,41 @@ void PlayOrganObject(unsigned char key, int mode, signed char track, long freq)
 	}
 }
 
-// オルガーニャオブジェクトを開放 (Open Organya object)
-void ReleaseOrganyaObject(signed char track)
+static void DestroySoundObject8(AudioBackend_Sound *buffer[8][2], ORGANWAVE *used[8])
 {
-	if (!audio_backend_initialised)
-		return;
-
 	for (int i = 0; i < 8; i++)
 	{
-		if (lpORGANBUFFER[track][i][0] != NULL)
+		for (int k = 0; k < 2; k++)
 		{
-			AudioBackend_DestroySound(lpORGANBUFFER[track][i][0]);
-			lpORGANBUFFER[track][i][0] = NULL;
+			if (buffer[i][k] != NULL)
+			{
+				AudioBackend_DestroySound(buffer[i][k]);
+				buffer[i][k] = NULL;
+				--used[i]->users;
+			}
 		}
-		if (lpORGANBUFFER[track][i][1] != NULL)
+
+		// Free the waveform once no track is using it anymore
+		if (used[i] != NULL && used[i]->users == 0)
 		{
-			AudioBackend_DestroySound(lpORGANBUFFER[track][i][1]);
-			lpORGANBUFFER[track][i][1] = NULL;
+			AudioBackend_DestroySound(used[i]->sound);
+			used[i]->sound = NULL;
 		}
+
+		used[i] = NULL;
 	}
 }
 
-// 波形データをロード (Load waveform data)
-signed char wave_data[100][0x100];
+// オルガーニャオブジェクトを開放 (Open Organya object)
+void ReleaseOrganyaObject(signed char track)
+{
+	if (!audio_backend_initialised)
+		return;
 
+	DestroySoundObject8(lpORGANBUFFER[track], organ_wave_used[track]);
+}
+
+// 波形データをロード (Load waveform data)
 BOOL InitWaveData100(void)
 {
 	if (!audio_backend_initialised)
@@ -339,11 +466,12 @@ BOOL MakeOrganyaWave(signed char track, signed char wave_no, signed char pipi)
 	if (!audio_backend_initialised)
 		return FALSE;
 
-	if (wave_no > 99)
+	if ((unsigned char)wave_no > 99)	// Negative numbers would index outside of the waveforms too
 		return FALSE;
 
 	ReleaseOrganyaObject(track);
-	MakeSoundObject8(wave_data[wave_no], track, pipi);
+	ResetOrganCache(track);
+	MakeSoundObject8(wave_no, lpORGANBUFFER[track], organ_wave_used[track], pipi);
 
 	return TRUE;
 }
@@ -357,7 +485,15 @@ void ChangeDramFrequency(unsigned char key, signed char track)
 	if (!audio_backend_initialised)
 		return;
 
-	AudioBackend_SetSoundFrequency(lpSECONDARYBUFFER[150 + track], key * 800 + 100);
+	ValidateDramCache(track);
+
+	const long new_frequency = key * 800 + 100;
+
+	if (dram_frequency_cache[track] != new_frequency)
+	{
+		dram_frequency_cache[track] = new_frequency;
+		AudioBackend_BatchSoundFrequency(lpSECONDARYBUFFER[150 + track], new_frequency);
+	}
 }
 
 void ChangeDramPan(unsigned char pan, signed char track)
@@ -365,7 +501,15 @@ void ChangeDramPan(unsigned char pan, signed char track)
 	if (!audio_backend_initialised)
 		return;
 
-	AudioBackend_SetSoundPan(lpSECONDARYBUFFER[150 + track], (pan_tbl[pan] - 0x100) * 10);
+	ValidateDramCache(track);
+
+	const long new_pan = (pan_tbl[pan] - 0x100) * 10;
+
+	if (dram_pan_cache[track] != new_pan)
+	{
+		dram_pan_cache[track] = new_pan;
+		AudioBackend_BatchSoundPan(lpSECONDARYBUFFER[150 + track], new_pan);
+	}
 }
 
 void ChangeDramVolume(long volume, signed char track)
@@ -373,7 +517,15 @@ void ChangeDramVolume(long volume, signed char track)
 	if (!audio_backend_initialised)
 		return;
 
-	AudioBackend_SetSoundVolume(lpSECONDARYBUFFER[150 + track], (volume - 0xFF) * 8);
+	ValidateDramCache(track);
+
+	const long new_volume = (volume - 0xFF) * 8;
+
+	if (dram_volume_cache[track] != new_volume)
+	{
+		dram_volume_cache[track] = new_volume;
+		AudioBackend_BatchSoundVolume(lpSECONDARYBUFFER[150 + track], new_volume);
+	}
 }
 
 // サウンドの再生 (Play sound)
@@ -387,15 +539,15 @@ void PlayDramObject(unsigned char key, int mode, signed char track)
 		switch (mode)
 		{
 			case 0:	// 停止 (Stop)
-				AudioBackend_StopSound(lpSECONDARYBUFFER[150 + track]);
-				AudioBackend_RewindSound(lpSECONDARYBUFFER[150 + track]);
+				AudioBackend_BatchStopSound(lpSECONDARYBUFFER[150 + track]);
+				AudioBackend_BatchRewindSound(lpSECONDARYBUFFER[150 + track]);
 				break;
 
 			case 1:	// 再生 (Playback)
-				AudioBackend_StopSound(lpSECONDARYBUFFER[150 + track]);
-				AudioBackend_RewindSound(lpSECONDARYBUFFER[150 + track]);
+				AudioBackend_BatchStopSound(lpSECONDARYBUFFER[150 + track]);
+				AudioBackend_BatchRewindSound(lpSECONDARYBUFFER[150 + track]);
 				ChangeDramFrequency(key, track);	// 周波数を設定して (Set the frequency)
-				AudioBackend_PlaySound(lpSECONDARYBUFFER[150 + track], FALSE);
+				AudioBackend_BatchPlaySound(lpSECONDARYBUFFER[150 + track], FALSE);
 				break;
 
 			case 2:	// 歩かせ停止 (Stop playback)
@@ -409,17 +561,12 @@ void PlayDramObject(unsigned char key, int mode, signed char track)
 
 ORGDATA org_data;
 
-static void OrganyaCallback(void)
-{
-	org_data.PlayData();
-}
-
 OrgData::OrgData(void)
 {
 	for (int i = 0; i < MAXTRACK; i++)
 	{
-		info.tdata[i].note_list = NULL;
-		info.tdata[i].note_p = NULL;
+		info.tdata[i].note_num = 0;
+		info.tdata[i].note_x = NULL;
 	}
 }
 
@@ -441,6 +588,10 @@ void OrgData::InitOrgData(void)
 	}
 
 	NoteAlloc(info.alloc_note);
+
+	for (int j = 0; j < MAXMELODY; j++)
+		MakeOrganyaWave(j, info.tdata[j].wave_no, info.tdata[j].pipi);
+
 	SetMusicInfo(&info, SETALL);
 
 	def_pan = DEFPAN;
@@ -499,20 +650,20 @@ BOOL OrgData::NoteAlloc(unsigned short alloc)
 	for (j = 0; j < MAXTRACK; j++)
 	{
 		info.tdata[j].wave_no = 0;
-		info.tdata[j].note_list = NULL;	// コンストラクタにやらせたい (I want the constructor to do it)
-		info.tdata[j].note_p = (NOTELIST*)malloc(sizeof(NOTELIST) * alloc);
+		info.tdata[j].note_num = 0;	// コンストラクタにやらせたい (I want the constructor to do it)
+		info.tdata[j].note_x = (long*)malloc((sizeof(long) + 4) * alloc);
 
-		if (info.tdata[j].note_p == NULL)
+		if (info.tdata[j].note_x == NULL)
 		{
 			for (i = 0; i < MAXTRACK; i++)
 			{
-				if (info.tdata[i].note_p != NULL)
+				if (info.tdata[i].note_x != NULL)
 				{
-					free(info.tdata[i].note_p);
+					free(info.tdata[i].note_x);
 				#ifdef FIX_BUGS
-					info.tdata[i].note_p = NULL;
+					info.tdata[i].note_x = NULL;
 				#else
-					info.tdata[j].note_p = NULL;	// Uses j instead of i
+					info.tdata[j].note_x = NULL;	// Uses j instead of i
 				#endif
 				}
 			}
@@ -520,19 +671,16 @@ BOOL OrgData::NoteAlloc(unsigned short alloc)
 			return FALSE;
 		}
 
-		for (i = 0; i < alloc; i++)
-		{
-			(info.tdata[j].note_p + i)->from = NULL;
-			(info.tdata[j].note_p + i)->to = NULL;
-			(info.tdata[j].note_p + i)->length = 0;
-			(info.tdata[j].note_p + i)->pan = PANDUMMY;
-			(info.tdata[j].note_p + i)->volume = VOLDUMMY;
-			(info.tdata[j].note_p + i)->y = KEYDUMMY;
-		}
-	}
+		info.tdata[j].note_y = (unsigned char*)(info.tdata[j].note_x + alloc);
+		info.tdata[j].note_length = info.tdata[j].note_y + alloc;
+		info.tdata[j].note_volume = info.tdata[j].note_length + alloc;
+		info.tdata[j].note_pan = info.tdata[j].note_volume + alloc;
 
-	for (j = 0; j < MAXMELODY; j++)
-		MakeOrganyaWave(j, info.tdata[j].wave_no, info.tdata[j].pipi);
+		memset(info.tdata[j].note_y, KEYDUMMY, alloc);
+		memset(info.tdata[j].note_length, 0, alloc);
+		memset(info.tdata[j].note_volume, VOLDUMMY, alloc);
+		memset(info.tdata[j].note_pan, PANDUMMY, alloc);
+	}
 
 	track = 0;	// 今はここに書いておく (Write here now)
 
@@ -544,10 +692,11 @@ void OrgData::ReleaseNote(void)
 {
 	for (int i = 0; i < MAXTRACK; i++)
 	{
-		if (info.tdata[i].note_p != NULL)
+		if (info.tdata[i].note_x != NULL)
 		{
-			free(info.tdata[i].note_p);
-			info.tdata[i].note_p = NULL;
+			free(info.tdata[i].note_x);
+			info.tdata[i].note_x = NULL;
+			info.tdata[i].note_num = 0;
 		}
 	}
 }
@@ -560,7 +709,6 @@ BOOL OrgData::InitMusicData(const char *path)
 	#define READ_LE16(p) ((p[1] << 8) | p[0]); p += 2
 	#define READ_LE32(p) ((p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0]); p += 4
 
-	NOTELIST *np;
 	int i,j;
 	char pass_check[6];
 	char ver = 0;
@@ -613,82 +761,40 @@ BOOL OrgData::InitMusicData(const char *path)
 	// 音符のロード (Loading notes)
 	for (j = 0; j < MAXTRACK; j++)
 	{
-		// 最初の音符はfromがNULLとなる (The first note has from as NULL)
-		if (note_num[j] == 0)
+	#ifdef FIX_BUGS
+		// The notes would overflow the arrays
+		if (note_num[j] > info.alloc_note)
 		{
-			info.tdata[j].note_list = NULL;
-			continue;
-		}
-
-		// リストを作る (Make a list)
-		np = info.tdata[j].note_p;
-		info.tdata[j].note_list = info.tdata[j].note_p;
-		np->from = NULL;
-		np->to = (np + 1);
-		np++;
+			for (i = 0; i < MAXTRACK; i++)
+				info.tdata[i].note_num = 0;
 
-		for (i = 1; i < note_num[j]; i++)
-		{
-			np->from = (np - 1);
-			np->to = (np + 1);
-			np++;
+			free(file_buffer);
+			return FALSE;
 		}
+	#endif
 
-		// 最後の音符のtoはNULL (The last note to is NULL)
-		np--;
-		np->to = NULL;
+		info.tdata[j].note_num = note_num[j];
 
 		// 内容を代入 (Assign content)
-		np = info.tdata[j].note_p;	// Ｘ座標 (X coordinate)
-		for (i = 0; i < note_num[j]; i++)
-		{
-			np->x = READ_LE32(p);
-			np++;
-		}
-
-		np = info.tdata[j].note_p;	// Ｙ座標 (Y coordinate)
-		for (i = 0; i < note_num[j]; i++)
-		{
-			np->y = *p++;
-			np++;
-		}
-
-		np = info.tdata[j].note_p;	// 長さ (Length)
-		for (i = 0; i < note_num[j]; i++)
-		{
-			np->length = *p++;
-			np++;
-		}
-
-		np = info.tdata[j].note_p;	// ボリューム (Volume)
-		for (i = 0; i < note_num[j]; i++)
+		for (i = 0; i < note_num[j]; i++)	// Ｘ座標 (X coordinate)
 		{
-			np->volume = *p++;
-			np++;
+			info.tdata[j].note_x[i] = READ_LE32(p);
 		}
 
-		np = info.tdata[j].note_p;	// パン (Pan)
-		for (i = 0; i < note_num[j]; i++)
-		{
-			np->pan = *p++;
-			np++;
-		}
+		// The rest of the fields are stored in the file the same way they are in memory
+		memcpy(info.tdata[j].note_y, p, note_num[j]);	// Ｙ座標 (Y coordinate)
+		p += note_num[j];
+		memcpy(info.tdata[j].note_length, p, note_num[j]);	// 長さ (Length)
+		p += note_num[j];
+		memcpy(info.tdata[j].note_volume, p, note_num[j]);	// ボリューム (Volume)
+		p += note_num[j];
+		memcpy(info.tdata[j].note_pan, p, note_num[j]);	// パン (Pan)
+		p += note_num[j];
 	}
 
 	free(file_buffer);
 
-	// データを有効に (Enable data)
-	for (j = 0; j < MAXMELODY; j++)
-		MakeOrganyaWave(j,info.tdata[j].wave_no, info.tdata[j].pipi);
-
-	// Pixel ripped out some code so he could use PixTone sounds as drums, but he left this dead code
-	for (j = MAXMELODY; j < MAXTRACK; j++)
-	{
-		i = info.tdata[j].wave_no;
-		//InitDramObject(dram_name[i], j - MAXMELODY);
-	}
-
-	SetPlayPointer(0);	// 頭出し (Cue)
+	// The waveforms are made, and the play pointer is set, once the song is swapped in by LoadOrganyaThread
 
 	return TRUE;
 }
@@ -713,7 +819,7 @@ void OrgData::GetMusicInfo(MUSICINFO *mi)
 
 // Play data
 long PlayPos;	// Called 'play_p' in the source code release
-NOTELIST *np[MAXTRACK];
+unsigned short note_cursor[MAXTRACK];	// The next note of each track
 long now_leng[MAXMELODY];
 
 int Volume = 100;
@@ -733,49 +839,55 @@ void OrgData::PlayData(void)
 	// メロディの再生 (Play melody)
 	for (i = 0; i < MAXMELODY; i++)
 	{
-		if (np[i] != NULL && PlayPos == np[i]->x)
+		const TRACKDATA *td = &info.tdata[i];
+		unsigned short n = note_cursor[i];
+
+		if (n < td->note_num && PlayPos == td->note_x[n])
 		{
-			if (!g_mute[i] && np[i]->y != KEYDUMMY)	// 音が来た。 (The sound has come.)
+			if (!g_mute[i] && !streaming && td->note_y[n] != KEYDUMMY)	// 音が来た。 (The sound has come.)
 			{
-				PlayOrganObject(np[i]->y, -1, i, info.tdata[i].freq);
-				now_leng[i] = np[i]->length;
+				PlayOrganObject(td->note_y[n], -1, i, td->freq);
+				now_leng[i] = td->note_length[n];
 			}
 
-			if (np[i]->pan != PANDUMMY)
-				ChangeOrganPan(np[i]->y, np[i]->pan, i);
-			if (np[i]->volume != VOLDUMMY)
-				TrackVol[i] = np[i]->volume;
+			if (td->note_pan[n] != PANDUMMY)
+				ChangeOrganPan(td->note_y[n], td->note_pan[n], i);
+			if (td->note_volume[n] != VOLDUMMY)
+				TrackVol[i] = td->note_volume[n];
 
-			np[i] = np[i]->to;	// 次の音符を指す (Points to the next note)
+			n = ++note_cursor[i];	// 次の音符を指す (Points to the next note)
 		}
 
 		if (now_leng[i] == 0)
-			PlayOrganObject(0, 2, i, info.tdata[i].freq);
+			PlayOrganObject(0, 2, i, td->freq);
 
 		if (now_leng[i] > 0)
 			now_leng[i]--;
 
-		if (np[i])
-			ChangeOrganVolume(np[i]->y, TrackVol[i] * Volume / 0x7F, i);
+		if (n < td->note_num)
+			ChangeOrganVolume(td->note_y[n], TrackVol[i] * Volume / 0x7F, i);
 	}
 
 	// ドラムの再生 (Drum playback)
 	for (i = MAXMELODY; i < MAXTRACK; i++)
 	{
-		if (np[i] != NULL && PlayPos == np[i]->x)	// 音が来た。 (The sound has come.)
+		const TRACKDATA *td = &info.tdata[i];
+		unsigned short n = note_cursor[i];
+
+		if (n < td->note_num && PlayPos == td->note_x[n])	// 音が来た。 (The sound has come.)
 		{
-			if (np[i]->y != KEYDUMMY && !g_mute[i])	// ならす (Tame)
-				PlayDramObject(np[i]->y, 1, i - MAXMELODY);
+			if (td->note_y[n] != KEYDUMMY && !g_mute[i])	// ならす (Tame)
+				PlayDramObject(td->note_y[n], 1, i - MAXMELODY);
 
-			if (np[i]->pan != PANDUMMY)
-				ChangeDramPan(np[i]->pan, i - MAXMELODY);
-			if (np[i]->volume != VOLDUMMY)
-				TrackVol[i] = np[i]->volume;
+			if (td->note_pan[n] != PANDUMMY)
+				ChangeDramPan(td->note_pan[n], i - MAXMELODY);
+			if (td->note_volume[n] != VOLDUMMY)
+				TrackVol[i] = td->note_volume[n];
 
-			np[i] = np[i]->to;	// 次の音符を指す (Points to the next note)
+			n = ++note_cursor[i];	// 次の音符を指す (Points to the next note)
 		}
 
-		if (np[i])
+		if (n < td->note_num)
 			ChangeDramVolume(TrackVol[i] * Volume / 0x7F, i - MAXMELODY);
 	}
 
@@ -792,14 +904,189 @@ void OrgData::SetPlayPointer(long x)
 {
 	for (int i = 0; i < MAXTRACK; i++)
 	{
-		np[i] = info.tdata[i].note_list;
-		while (np[i] != NULL && np[i]->x < x)
-			np[i] = np[i]->to;	// 見るべき音符を設定 (Set note to watch)
+		// The notes are in order of position, so the first one at or after `x` can be found with a binary search
+		unsigned int first = 0;
+		unsigned int last = info.tdata[i].note_num;
+
+		while (first < last)
+		{
+			const unsigned int middle = (first + last) / 2;
+
+			if (info.tdata[i].note_x[middle] < x)
+				first = middle + 1;
+			else
+				last = middle;
+		}
+
+		note_cursor[i] = (unsigned short)first;	// 見るべき音符を設定 (Set note to watch)
 	}
 
 	PlayPos = x;
 }
 
+#ifdef ORGANYA_PRERENDER
+// A render can't leave tracks out, so the instruments take over again while any are muted
+static BOOL IsAnyInstrumentMuted(void)
+{
+	for (int i = 0; i < MAXMELODY; i++)
+		if (g_mute[i])
+			return TRUE;
+
+	return FALSE;
+}
+
+// Silences the instruments, for the stream to take over from them
+static void StopOrganyaInstruments(void)
+{
+	for (int i = 0; i < MAXMELODY; i++)
+		for (int j = 0; j < 8; j++)
+			for (int k = 0; k < 2; k++)
+				AudioBackend_BatchStopSound(lpORGANBUFFER[i][j][k]);
+
+	memset(old_key, 255, sizeof(old_key));
+	memset(key_on, 0, sizeof(key_on));
+	memset(key_twin, 0, sizeof(key_twin));
+}
+
+// The render is of the song itself, so this is what the song carries over from the one before it
+static void GetOrganyaCarryover(ORGANYA_CARRYOVER *carryover)
+{
+	memcpy(carryover->track_volumes, TrackVol, sizeof(carryover->track_volumes));
+}
+#endif
+
+static void OrganyaCallback(void)
+{
+	// Apply the whole tick's worth of changes at once
+	AudioBackend_BeginBatch();
+
+#ifdef ORGANYA_PRERENDER
+	const BOOL can_stream = OrganyaStream_IsReady() && !IsAnyInstrumentMuted();
+
+	if (can_stream && !streaming)
+	{
+		StopOrganyaInstruments();
+		OrganyaStream_Start(PlayPos, looped);
+		streaming = TRUE;
+	}
+	else if (!can_stream && streaming)
+	{
+		OrganyaStream_Stop();
+		streaming = FALSE;
+	}
+
+	const long old_position = PlayPos;
+
+	org_data.PlayData();
+
+	if (PlayPos < old_position)
+		looped = TRUE;
+
+	// The song was rendered at full volume, so turn it down by as much as a track at the default volume would be
+	if (streaming)
+		OrganyaStream_SetVolume(((DEFVOLUME * Volume / 0x7F) - (DEFVOLUME * 100 / 0x7F)) * 8);
+#else
+	org_data.PlayData();
+#endif
+
+	AudioBackend_CommitBatch();
+}
+
+// Songs are loaded on a worker thread, so that changing the music doesn't hold up the game.
+// The new song is parsed and its instruments are made off to the side, and then swapped in
+// while the Organya timer is stopped. Anything the game asks of the song in the meantime is
+// kept in the 'pending' variables, and applied when it's swapped in.
+static ORGDATA staged_org_data;
+static AudioBackend_Sound *staged_organ_buffer[MAXMELODY][8][2];
+static ORGANWAVE *staged_organ_wave_used[MAXMELODY][8];
+static std::string staged_path;
+
+static Backend_Thread *load_thread;
+static Backend_Mutex *load_mutex;	// Guards everything below
+static BOOL load_pending;
+static BOOL load_succeeded;
+static long pending_position;
+static BOOL pending_play;
+
+static void LoadOrganyaThread(void *user_data)
+{
+	(void)user_data;
+
+	int i, j;
+	BOOL wave_made[MAXMELODY];
+	const BOOL loaded = staged_org_data.InitMusicData(staged_path.c_str());
+
+	if (loaded)
+	{
+		// データを有効に (Enable data)
+		for (j = 0; j < MAXMELODY; j++)
+		{
+			wave_made[j] = staged_org_data.info.tdata[j].wave_no <= 99;
+
+			if (wave_made[j])
+				MakeSoundObject8(staged_org_data.info.tdata[j].wave_no, staged_organ_buffer[j], staged_organ_wave_used[j], staged_org_data.info.tdata[j].pipi);
+		}
+
+		// Pixel ripped out some code so he could use PixTone sounds as drums, but he left this dead code
+		for (j = MAXMELODY; j < MAXTRACK; j++)
+		{
+			i = staged_org_data.info.tdata[j].wave_no;
+			//InitDramObject(dram_name[i], j - MAXMELODY);
+		}
+	}
+
+	Backend_LockMutex(load_mutex);
+
+	// If the song couldn't be loaded, the old one is left in its place
+	if (loaded)
+	{
+		const MUSICINFO old_info = org_data.info;
+		org_data.info = staged_org_data.info;
+		staged_org_data.info = old_info;
+
+		for (j = 0; j < MAXMELODY; j++)
+		{
+			if (wave_made[j])
+			{
+				AudioBackend_Sound *old_buffer[8][2];
+				memcpy(old_buffer, lpORGANBUFFER[j], sizeof(old_buffer));
+				memcpy(lpORGANBUFFER[j], staged_organ_buffer[j], sizeof(old_buffer));
+				memcpy(staged_organ_buffer[j], old_buffer, sizeof(old_buffer));
+
+				ORGANWAVE *old_used[8];
+				memcpy(old_used, organ_wave_used[j], sizeof(old_used));
+				memcpy(organ_wave_used[j], staged_organ_wave_used[j], sizeof(old_used));
+				memcpy(staged_organ_wave_used[j], old_used, sizeof(old_used));
+
+				ResetOrganCache(j);
+			}
+		}
+	}
+
+	org_data.SetPlayPointer(pending_position);	// 頭出し (Cue)
+
+	if (pending_play)
+		AudioBackend_SetOrganyaTimer(org_data.info.wait);
+
+	load_pending = FALSE;
+	load_succeeded = loaded;
+
+	Backend_UnlockMutex(load_mutex);
+
+	// Nothing refers to the old song's instruments anymore
+	for (j = 0; j < MAXMELODY; j++)
+		DestroySoundObject8(staged_organ_buffer[j], staged_organ_wave_used[j]);
+}
+
+static void WaitForOrganyaLoad(void)
+{
+	if (load_thread != NULL)
+	{
+		Backend_JoinThread(load_thread);
+		load_thread = NULL;
+	}
+}
+
 // Start and end organya
 BOOL StartOrganya(const char *path_wave)	// The argument is ignored for some reason
 {
@@ -809,10 +1096,21 @@ BOOL StartOrganya(const char *path_wave)	// The argument is ignored for some rea
 	if (!InitWaveData100())
 		return FALSE;
 
+	ResetDramCache();
+
 	org_data.InitOrgData();
 
+	staged_org_data.info.alloc_note = ALLOCNOTE;
+	staged_org_data.NoteAlloc(staged_org_data.info.alloc_note);
+
+	load_mutex = Backend_CreateMutex();
+
 	AudioBackend_SetOrganyaCallback(OrganyaCallback);
 
+#ifdef ORGANYA_PRERENDER
+	OrganyaStream_Init();	// Without it, songs are just never streamed
+#endif
+
 	return TRUE;
 }
 
@@ -822,14 +1120,49 @@ BOOL LoadOrganya(const char *name)
 	if (!audio_backend_initialised)
 		return FALSE;
 
-	if (!org_data.InitMusicData(name))
-		return FALSE;
+	WaitForOrganyaLoad();
+
+	// The song's data can't change while it's playing
+	AudioBackend_SetOrganyaTimer(0);
+
+	staged_path = name;
+	load_pending = TRUE;
+	pending_position = 0;
+	pending_play = FALSE;
+
+#ifdef ORGANYA_PRERENDER
+	// The timer is stopped, so the stream can be stopped without locking
+	if (streaming)
+	{
+		AudioBackend_BeginBatch();
+		OrganyaStream_Stop();
+		AudioBackend_CommitBatch();
+
+		streaming = FALSE;
+	}
+
+	ORGANYA_CARRYOVER carryover;
+	GetOrganyaCarryover(&carryover);
+	OrganyaStream_Request(name, &carryover);
+
+	looped = FALSE;
+#endif
+
+	load_thread = Backend_CreateThread(LoadOrganyaThread, NULL);
+
+	// Without threads, the song has to be loaded right here
+	if (load_thread == NULL)
+		LoadOrganyaThread(NULL);
+
+	// The drums are PixTone sounds, but they're still part of the music
+	for (int i = 0; i < MAXDRAM; i++)
+		AudioBackend_SetSoundPriority(lpSECONDARYBUFFER[150 + i], AUDIOBACKEND_PRIORITY_MUSIC);
 
 	Volume = 100;
 	bFadeout = 0;
 
 #ifdef FIX_BUGS
-	return TRUE;
+	return TRUE;	// The song may still be loading, so this can't say whether it worked
 #else
 	return FALSE;	// Err... isn't this meant to be 'TRUE'?
 #endif
@@ -840,9 +1173,35 @@ void SetOrganyaPosition(unsigned int x)
 	if (!audio_backend_initialised)
 		return;
 
-	org_data.SetPlayPointer(x);
+	Backend_LockMutex(load_mutex);
+
+	if (load_pending)
+	{
+		pending_position = x;
+	}
+	else
+	{
+#ifdef ORGANYA_PRERENDER
+		// The audio callback mustn't see the position and the stream disagree
+		AudioBackend_Lock();
+
+		org_data.SetPlayPointer(x);
+
+		if (streaming)
+			OrganyaStream_Seek(x, FALSE);
+
+		looped = FALSE;
+
+		AudioBackend_Unlock();
+#else
+		org_data.SetPlayPointer(x);
+#endif
+	}
+
 	Volume = 100;
 	bFadeout = FALSE;
+
+	Backend_UnlockMutex(load_mutex);
 }
 
 unsigned int GetOrganyaPosition(void)
@@ -850,7 +1209,30 @@ unsigned int GetOrganyaPosition(void)
 	if (!audio_backend_initialised)
 		return 0;
 
-	return PlayPos;
+	Backend_LockMutex(load_mutex);
+	const unsigned int position = load_pending ? pending_position : PlayPos;
+	Backend_UnlockMutex(load_mutex);
+
+	return position;
+}
+
+// Waits for the last song to finish loading, and gets where it loops from and to (in beats), and
+// how long each beat lasts (in milliseconds). Returns FALSE if the song couldn't be loaded.
+BOOL GetOrganyaLoop(long *repeat_x, long *end_x, unsigned short *wait)
+{
+	if (!audio_backend_initialised)
+		return FALSE;
+
+	WaitForOrganyaLoad();
+
+	if (!load_succeeded)
+		return FALSE;
+
+	*repeat_x = org_data.info.repeat_x;
+	*end_x = org_data.info.end_x;
+	*wait = org_data.info.wait;
+
+	return TRUE;
 }
 
 void PlayOrganyaMusic(void)
@@ -858,7 +1240,14 @@ void PlayOrganyaMusic(void)
 	if (!audio_backend_initialised)
 		return;
 
-	AudioBackend_SetOrganyaTimer(org_data.info.wait);
+	Backend_LockMutex(load_mutex);
+
+	if (load_pending)
+		pending_play = TRUE;
+	else
+		AudioBackend_SetOrganyaTimer(org_data.info.wait);
+
+	Backend_UnlockMutex(load_mutex);
 }
 
 BOOL ChangeOrganyaVolume(signed int volume)
@@ -878,22 +1267,34 @@ void StopOrganyaMusic(void)
 	if (!audio_backend_initialised)
 		return;
 
+	WaitForOrganyaLoad();
+
 	AudioBackend_SetOrganyaTimer(0);
 
 	// Stop notes
+	AudioBackend_BeginBatch();
+
 	for (int i = 0; i < MAXMELODY; i++)
 		PlayOrganObject(0, 2, i, 0);
 
+#ifdef ORGANYA_PRERENDER
+	if (streaming)
+	{
+		OrganyaStream_Stop();
+		streaming = FALSE;
+	}
+#endif
+
+	AudioBackend_CommitBatch();
+
 	memset(old_key, 255, sizeof(old_key));
 	memset(key_on, 0, sizeof(key_on));
 	memset(key_twin, 0, sizeof(key_twin));
 
-	// Put the main thread to sleep for 100 milliseconds... but why?
-	// Really, what's the point? All this does is cause an annoying
-	// stutter when a new song loads.
-	// I'd guess it avoids a race-condition with the Organya thread,
-	// but the earlier QuitMMTimer call already disables it.
-	Backend_Delay(100);
+	// The original put the main thread to sleep for 100 milliseconds here,
+	// which caused an annoying stutter whenever a new song loaded. It isn't
+	// needed: the audio backend stops the Organya timer under the same lock
+	// that it updates Organya with.
 }
 
 void SetOrganyaFadeout(void)
@@ -906,14 +1307,28 @@ void EndOrganya(void)
 	if (!audio_backend_initialised)
 		return;
 
+	WaitForOrganyaLoad();
+
 	AudioBackend_SetOrganyaTimer(0);
 
+#ifdef ORGANYA_PRERENDER
+	OrganyaStream_Deinit();
+	streaming = FALSE;
+#endif
+
 	// Release everything related to org
 	org_data.ReleaseNote();
+	staged_org_data.ReleaseNote();
+
+	Backend_DestroyMutex(load_mutex);
+	load_mutex = NULL;
 
 	for (int i = 0; i < MAXMELODY; i++)
 	{
+		AudioBackend_BeginBatch();
 		PlayOrganObject(0, 0, i, 0);
+		AudioBackend_CommitBatch();
+
 		ReleaseOrganyaObject(i);
 	}
 }
@@ -21,6 +21,7 @@ void SetPlayPointer(long x);
 BOOL LoadOrganya(const char *name);
 void SetOrganyaPosition(unsigned int x);
 unsigned int GetOrganyaPosition(void);
+BOOL GetOrganyaLoop(long *repeat_x, long *end_x, unsigned short *wait);
 void PlayOrganyaMusic(void);
 BOOL ChangeOrganyaVolume(signed int volume);
 void StopOrganyaMusic(void);
@@ -0,0 +1,238 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// The renderer is a second copy of Organya and the software mixer, compiled into a namespace of
+// its own so that it shares no state with the game's copy, and run by the offline audio backend.
+// Songs are rendered by playing them exactly the way that the game does, so that they sound the
+// same. The copy has no sound effects, so its drums are silent.
+
+// Everything that the copied sources include from outside of them is included here first, so
+// that only their own declarations end up in the namespace
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+#endif
+
+#include "WindowsWrapper.h"
+
+#include "Attributes.h"
+#include "Backends/Misc.h"
+#include "File.h"
+#include "Main.h"
+
+// The copy of Organya plays songs by itself
+#undef ORGANYA_PRERENDER
+
+namespace OrganyaRender
+{
+// Mixer.cpp and SoftwareMixer.cpp both have a static variable with this name
+#define output_frequency mixer_output_frequency
+#include "Backends/Audio/SoftwareMixer/Mixer.cpp"
+#undef output_frequency
+#include "Backends/Audio/SoftwareMixer/Offline.cpp"
+#include "Backends/Audio/SoftwareMixer.cpp"
+#include "Organya.cpp"
+
+// These belong to Sound.cpp, which the copy doesn't need the rest of
+BOOL audio_backend_initialised;
+AudioBackend_Sound *lpSECONDARYBUFFER[SE_MAX];
+}
+
+// This has to come after the copy, because it includes Organya.h, which the copy needs its own
+// declarations from
+#include "OrganyaRender.h"
+
+using namespace OrganyaRender;
+
+#define RENDER_PERIOD 0x400	// How many frames are rendered at a time
+
+BOOL OrganyaRender_Init(unsigned long frequency)
+{
+	// This is AudioBackend_Init, minus logging the output format, since this isn't the game's output
+	output_period = RENDER_PERIOD;
+	output_frequency = SoftwareMixerBackend_Init(Callback, frequency, &output_period);
+	organya_callback_timer = 0;
+
+	Mixer_Init(output_frequency);
+
+	audio_backend_initialised = TRUE;
+
+	if (!StartOrganya(NULL))
+	{
+		SoftwareMixerBackend_Deinit();
+		audio_backend_initialised = FALSE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void OrganyaRender_Deinit(void)
+{
+	if (!audio_backend_initialised)
+		return;
+
+	EndOrganya();
+	AudioBackend_Deinit();
+
+	audio_backend_initialised = FALSE;
+}
+
+BOOL OrganyaRender_LoadSong(const char *path, ORGANYA_CARRYOVER *carryover)
+{
+	long repeat_x, end_x;
+	unsigned short wait;
+
+	StopOrganyaMusic();
+	LoadOrganya(path);
+
+	if (!GetOrganyaLoop(&repeat_x, &end_x, &wait) || repeat_x < 0 || end_x <= repeat_x)
+		return FALSE;
+
+	for (int i = 0; i < MAXMELODY; ++i)
+	{
+		const TRACKDATA *td = &org_data.info.tdata[i];
+
+		// Tracks without a valid instrument keep the previous song's, which this copy might not have
+		if (td->wave_no > 99)
+			return FALSE;
+
+		// A track only depends on the old volume if it plays a note before setting its own. The
+		// volume is set every beat up to the track's last note, but not along with that note.
+		BOOL volume_needed = FALSE;
+
+		for (unsigned short n = 0; n < td->note_num; ++n)
+		{
+			if (td->note_y[n] != KEYDUMMY && (td->note_volume[n] == VOLDUMMY || n + 1 == td->note_num))
+				volume_needed = TRUE;
+
+			if (volume_needed || td->note_volume[n] != VOLDUMMY)
+				break;
+		}
+
+		if (!volume_needed)
+			carryover->track_volumes[i] = 0;
+	}
+
+	return TRUE;
+}
+
+BOOL OrganyaRender_RenderSong(const ORGANYA_CARRYOVER *carryover, size_t max_frames, BOOL (*cancelled)(void), ORGANYA_RENDER *render)
+{
+	// Start from the same state that the game's copy would be in
+	memcpy(TrackVol, carryover->track_volumes, sizeof(carryover->track_volumes));
+	memset(now_leng, 0, sizeof(now_leng));
+
+	ChangeOrganyaVolume(100);
+	SetOrganyaPosition(0);
+	organya_callback_timer = 0;	// So that the first beat lands on the first frame
+	PlayOrganyaMusic();
+
+	const unsigned long beat_frames = organya_callback_timer_master;
+	const long repeat_x = org_data.info.repeat_x;
+	const long end_x = org_data.info.end_x;
+
+	// Leave room for the second pass too
+	if (beat_frames == 0 || (unsigned long)end_x > max_frames / beat_frames || (unsigned long)(end_x - repeat_x) > max_frames / beat_frames - end_x)
+	{
+		StopOrganyaMusic();
+		return FALSE;
+	}
+
+	const size_t intro_frames = repeat_x * beat_frames;
+	const size_t loop_frames = (end_x - repeat_x) * beat_frames;
+
+	size_t capacity = intro_frames + loop_frames;
+	short *samples = (short*)malloc(capacity * 2 * sizeof(short));
+
+	BOOL success = samples != NULL;
+
+	for (size_t frame = 0; success && frame < intro_frames + loop_frames; frame += RENDER_PERIOD)
+	{
+		if (cancelled())
+			success = FALSE;
+		else
+			SoftwareMixerBackend_Render(&samples[frame * 2], MIN(RENDER_PERIOD, intro_frames + loop_frames - frame));
+	}
+
+	// The second pass starts off differently to the first, because of what was still playing when
+	// the first one ended, so it's only kept up to where it stops being different
+	size_t wrap_frames = 0;
+
+	for (size_t frame = 0; success && frame < loop_frames; frame += RENDER_PERIOD)
+	{
+		short buffer[RENDER_PERIOD * 2];
+		const size_t frames = MIN(RENDER_PERIOD, loop_frames - frame);
+
+		if (cancelled())
+		{
+			success = FALSE;
+			break;
+		}
+
+		SoftwareMixerBackend_Render(buffer, frames);
+
+		const short *first_pass = &samples[(intro_frames + frame) * 2];
+
+		size_t different_samples = frames * 2;
+
+		while (different_samples != 0 && buffer[different_samples - 1] == first_pass[different_samples - 1])
+			--different_samples;
+
+		if (different_samples != 0)
+		{
+			const size_t new_wrap_frames = frame + (different_samples + 1) / 2;
+
+			if (intro_frames + loop_frames + new_wrap_frames > capacity)
+			{
+				const size_t new_capacity = MIN(MAX(intro_frames + loop_frames + new_wrap_frames, capacity + loop_frames / 4), intro_frames + loop_frames * 2);
+				short *new_samples = (short*)realloc(samples, new_capacity * 2 * sizeof(short));
+
+				if (new_samples == NULL)
+				{
+					success = FALSE;
+					break;
+				}
+
+				samples = new_samples;
+				capacity = new_capacity;
+			}
+
+			// Up to this chunk, the second pass was the same as the first
+			memcpy(&samples[(intro_frames + loop_frames + wrap_frames) * 2], &samples[(intro_frames + wrap_frames) * 2], (frame - wrap_frames) * 2 * sizeof(short));
+			memcpy(&samples[(intro_frames + loop_frames + frame) * 2], buffer, (new_wrap_frames - frame) * 2 * sizeof(short));
+
+			wrap_frames = new_wrap_frames;
+		}
+	}
+
+	StopOrganyaMusic();
+
+	if (!success)
+	{
+		free(samples);
+		return FALSE;
+	}
+
+	// Give back what the second pass didn't need
+	short *trimmed_samples = (short*)realloc(samples, (intro_frames + loop_frames + wrap_frames) * 2 * sizeof(short));
+
+	render->samples = trimmed_samples != NULL ? trimmed_samples : samples;
+	render->intro_frames = intro_frames;
+	render->loop_frames = loop_frames;
+	render->wrap_frames = wrap_frames;
+	render->repeat_x = repeat_x;
+	render->beat_frames = beat_frames;
+
+	return TRUE;
+}
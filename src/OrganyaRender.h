@@ -0,0 +1,41 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "WindowsWrapper.h"
+
+#include "Organya.h"
+
+// Renders Organya songs' instruments to PCM with a private copy of Organya and the software mixer,
+// so that songs can be rendered on another thread while the game plays music with its own copy.
+// The drums are left out, since they're sound effects that the game plays itself. Only one thread
+// may use the renderer at a time.
+
+// Besides the song itself, how a song's instruments sound depends on the track volumes that
+// Organya carries over from the song before it
+typedef struct ORGANYA_CARRYOVER
+{
+	int track_volumes[MAXMELODY];	// Organya's TrackVol
+} ORGANYA_CARRYOVER;
+
+typedef struct ORGANYA_RENDER
+{
+	short *samples;	// 16-bit stereo: the intro, the first pass of the loop, then the start of the second pass
+	size_t intro_frames;
+	size_t loop_frames;
+	size_t wrap_frames;	// How much of the second pass differs from the first (later passes are played as the second)
+	long repeat_x;	// In beats
+	unsigned long beat_frames;
+} ORGANYA_RENDER;
+
+BOOL OrganyaRender_Init(unsigned long frequency);
+void OrganyaRender_Deinit(void);
+// Loads a song, and clears the parts of `carryover` that it doesn't depend on, so that renders
+// that would come out the same compare equal. Fails if the song can't be rendered.
+BOOL OrganyaRender_LoadSong(const char *path, ORGANYA_CARRYOVER *carryover);
+// Renders the song that was just loaded, giving up if `cancelled` returns TRUE.
+// Songs longer than `max_frames` aren't rendered. `render->samples` must be freed with free().
+BOOL OrganyaRender_RenderSong(const ORGANYA_CARRYOVER *carryover, size_t max_frames, BOOL (*cancelled)(void), ORGANYA_RENDER *render);
@@ -0,0 +1,384 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Songs are rendered by a worker thread which only runs while there's something to render: the
+// game thread starts it when it makes a request, and it exits once there are none left, so the
+// game thread never has to wait for it. A new request abandons the render in progress.
+
+#include "OrganyaStream.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "WindowsWrapper.h"
+
+#include "Backends/Audio.h"
+#include "Backends/Misc.h"
+#include "Organya.h"
+#include "OrganyaRender.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#define MAX_CACHE_SIZE (64 * 1024 * 1024)	// In bytes - the oldest renders are thrown away to stay under it
+
+typedef struct CachedSong
+{
+	std::string path;
+	unsigned long frequency;
+	ORGANYA_CARRYOVER carryover;
+	ORGANYA_RENDER render;
+	unsigned long last_used;
+	struct CachedSong *next;
+} CachedSong;
+
+static BOOL initialised;
+static unsigned long output_frequency;
+
+static Backend_Thread *render_thread;
+static Backend_Mutex *request_mutex;	// Guards the request
+static BOOL worker_running;
+static BOOL quitting;
+static BOOL request_pending;
+static std::string request_path;
+static ORGANYA_CARRYOVER request_carryover;
+static unsigned long request_serial;
+
+// Only the worker thread uses these
+static BOOL renderer_tried;
+static BOOL renderer_initialised;
+static CachedSong *cache_head;
+static size_t cache_size;
+static unsigned long cache_use_counter;
+
+// Guarded by the audio backend's lock
+static AudioBackend_Sound *stream;
+static CachedSong *ready_song;	// The last requested song's render, once it's done
+static CachedSong *playing_song;	// The render that the stream plays
+static size_t stream_position;	// In frames, along the song rather than the render
+static BOOL stream_looped;
+static long stream_volume;
+
+static size_t GetRenderSize(const ORGANYA_RENDER *render)
+{
+	return (render->intro_frames + render->loop_frames + render->wrap_frames) * 2 * sizeof(short);
+}
+
+static CachedSong* FindSong(const std::string &path, const ORGANYA_CARRYOVER *carryover)
+{
+	for (CachedSong *song = cache_head; song != NULL; song = song->next)
+		if (song->path == path && song->frequency == output_frequency && memcmp(&song->carryover, carryover, sizeof(ORGANYA_CARRYOVER)) == 0)
+			return song;
+
+	return NULL;
+}
+
+static CachedSong* AddSong(const std::string &path, const ORGANYA_CARRYOVER *carryover, const ORGANYA_RENDER *render)
+{
+	// Make room by throwing away the least recently used renders, as long as the stream isn't using them
+	while (cache_size + GetRenderSize(render) > MAX_CACHE_SIZE)
+	{
+		CachedSong **oldest = NULL;
+
+		AudioBackend_Lock();
+
+		for (CachedSong **song = &cache_head; *song != NULL; song = &(*song)->next)
+			if (*song != ready_song && *song != playing_song && (oldest == NULL || (*song)->last_used < (*oldest)->last_used))
+				oldest = song;
+
+		AudioBackend_Unlock();
+
+		if (oldest == NULL)
+			break;
+
+		CachedSong *old_song = *oldest;
+		*oldest = old_song->next;
+		cache_size -= GetRenderSize(&old_song->render);
+		free(old_song->render.samples);
+		delete old_song;
+	}
+
+	CachedSong *song = new CachedSong;
+	song->path = path;
+	song->frequency = output_frequency;
+	song->carryover = *carryover;
+	song->render = *render;
+	song->next = cache_head;
+	cache_head = song;
+	cache_size += GetRenderSize(render);
+
+	return song;
+}
+
+static BOOL IsRenderCancelled(void)
+{
+	Backend_LockMutex(request_mutex);
+	const BOOL cancelled = request_pending || quitting;
+	Backend_UnlockMutex(request_mutex);
+
+	return cancelled;
+}
+
+static void RenderThread(void *user_data)
+{
+	(void)user_data;
+
+	for (;;)
+	{
+		Backend_LockMutex(request_mutex);
+
+		if (!request_pending || quitting)
+		{
+			worker_running = FALSE;
+			Backend_UnlockMutex(request_mutex);
+			return;
+		}
+
+		const std::string path = request_path;
+		ORGANYA_CARRYOVER carryover = request_carryover;
+		const unsigned long serial = request_serial;
+		request_pending = FALSE;
+
+		Backend_UnlockMutex(request_mutex);
+
+		if (!renderer_tried)
+		{
+			renderer_tried = TRUE;
+			renderer_initialised = OrganyaRender_Init(output_frequency);
+		}
+
+		CachedSong *song = NULL;
+
+		if (renderer_initialised && OrganyaRender_LoadSong(path.c_str(), &carryover))
+		{
+			song = FindSong(path, &carryover);
+
+			if (song == NULL)
+			{
+				ORGANYA_RENDER render;
+
+				if (OrganyaRender_RenderSong(&carryover, MAX_CACHE_SIZE / (2 * sizeof(short)), IsRenderCancelled, &render))
+					song = AddSong(path, &carryover, &render);
+			}
+		}
+
+		if (song != NULL)
+		{
+			song->last_used = ++cache_use_counter;
+
+			// Only hand it over if it's still the song that the game wants
+			Backend_LockMutex(request_mutex);
+
+			if (serial == request_serial)
+			{
+				AudioBackend_Lock();
+				ready_song = song;
+				AudioBackend_Unlock();
+			}
+
+			Backend_UnlockMutex(request_mutex);
+		}
+	}
+}
+
+// Plays the render as the song itself would: the intro, then the loop forever, with the
+// second pass's differences in place of the start of every pass after the first
+static size_t StreamCallback(void *user_data, short *buffer, size_t frames)
+{
+	(void)user_data;
+
+	if (playing_song == NULL)
+	{
+		memset(buffer, 0, frames * 2 * sizeof(short));
+		return frames;
+	}
+
+	const ORGANYA_RENDER *render = &playing_song->render;
+	const size_t end_frame = render->intro_frames + render->loop_frames;
+
+	size_t frames_done = 0;
+
+	while (frames_done != frames)
+	{
+		const short *source;
+		size_t frames_available;
+
+		if (stream_looped && stream_position >= render->intro_frames && stream_position < render->intro_frames + render->wrap_frames)
+		{
+			source = &render->samples[(end_frame + stream_position - render->intro_frames) * 2];
+			frames_available = render->intro_frames + render->wrap_frames - stream_position;
+		}
+		else
+		{
+			source = &render->samples[stream_position * 2];
+			frames_available = end_frame - stream_position;
+		}
+
+		const size_t frames_to_do = MIN(frames_available, frames - frames_done);
+
+		memcpy(&buffer[frames_done * 2], source, frames_to_do * 2 * sizeof(short));
+
+		frames_done += frames_to_do;
+		stream_position += frames_to_do;
+
+		if (stream_position == end_frame)
+		{
+			stream_position = render->intro_frames;
+			stream_looped = TRUE;
+		}
+	}
+
+	return frames;
+}
+
+BOOL OrganyaStream_Init(void)
+{
+	size_t period;
+	AudioBackend_GetOutputFormat(&output_frequency, &period);
+
+	// Only backends that mix in software can play streams
+	if (output_frequency == 0)
+		return FALSE;
+
+	stream = AudioBackend_CreateStream(StreamCallback, NULL);
+
+	if (stream == NULL)
+		return FALSE;
+
+	AudioBackend_SetSoundPriority(stream, AUDIOBACKEND_PRIORITY_MUSIC);
+
+	request_mutex = Backend_CreateMutex();
+
+	initialised = TRUE;
+
+	return TRUE;
+}
+
+void OrganyaStream_Deinit(void)
+{
+	if (!initialised)
+		return;
+
+	Backend_LockMutex(request_mutex);
+	quitting = TRUE;
+	Backend_UnlockMutex(request_mutex);
+
+	if (render_thread != NULL)
+	{
+		Backend_JoinThread(render_thread);
+		render_thread = NULL;
+	}
+
+	AudioBackend_DestroySound(stream);
+	stream = NULL;
+	ready_song = NULL;
+	playing_song = NULL;
+
+	while (cache_head != NULL)
+	{
+		CachedSong *next = cache_head->next;
+		free(cache_head->render.samples);
+		delete cache_head;
+		cache_head = next;
+	}
+
+	cache_size = 0;
+
+	if (renderer_initialised)
+		OrganyaRender_Deinit();
+
+	renderer_tried = FALSE;
+	renderer_initialised = FALSE;
+
+	Backend_DestroyMutex(request_mutex);
+	request_mutex = NULL;
+
+	initialised = FALSE;
+}
+
+void OrganyaStream_Request(const char *path, const ORGANYA_CARRYOVER *carryover)
+{
+	if (!initialised)
+		return;
+
+	Backend_LockMutex(request_mutex);
+
+	request_path = path;
+	request_carryover = *carryover;
+	request_pending = TRUE;
+	++request_serial;
+
+	// Whatever was ready was for the last song
+	AudioBackend_Lock();
+	ready_song = NULL;
+	AudioBackend_Unlock();
+
+	const BOOL start_worker = !worker_running;
+	worker_running = TRUE;
+
+	Backend_UnlockMutex(request_mutex);
+
+	if (start_worker)
+	{
+		// The last worker has already finished, so this doesn't wait
+		if (render_thread != NULL)
+			Backend_JoinThread(render_thread);
+
+		render_thread = Backend_CreateThread(RenderThread, NULL);
+
+		// Without threads, songs are never rendered, and Organya just plays them by itself
+		if (render_thread == NULL)
+		{
+			Backend_LockMutex(request_mutex);
+			worker_running = FALSE;
+			request_pending = FALSE;
+			Backend_UnlockMutex(request_mutex);
+		}
+	}
+}
+
+BOOL OrganyaStream_IsReady(void)
+{
+	return ready_song != NULL;
+}
+
+void OrganyaStream_Start(long x, BOOL looped)
+{
+	playing_song = ready_song;
+	OrganyaStream_Seek(x, looped);
+
+	stream_volume = LONG_MIN;	// Whatever it was, it's set again before the stream is heard
+	AudioBackend_BatchPlaySound(stream, true);
+}
+
+void OrganyaStream_Seek(long x, BOOL looped)
+{
+	if (playing_song == NULL)
+		return;
+
+	const ORGANYA_RENDER *render = &playing_song->render;
+	const long end_x = render->repeat_x + (long)(render->loop_frames / render->beat_frames);
+
+	// Organya goes straight back to the start of the loop from anywhere past the end of the song
+	if (x < 0 || x >= end_x)
+		x = render->repeat_x;
+
+	stream_position = x * render->beat_frames;
+	stream_looped = looped;
+}
+
+void OrganyaStream_Stop(void)
+{
+	AudioBackend_BatchStopSound(stream);
+}
+
+void OrganyaStream_SetVolume(long volume)
+{
+	if (stream_volume != volume)
+	{
+		stream_volume = volume;
+		AudioBackend_BatchSoundVolume(stream, volume);
+	}
+}
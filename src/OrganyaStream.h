@@ -0,0 +1,25 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include "WindowsWrapper.h"
+
+#include "OrganyaRender.h"
+
+// Renders Organya songs' instruments on a worker thread as they're loaded (see OrganyaRender.h),
+// so that they can be streamed instead of sequenced in the audio callback. Renders are cached by song, sample
+// rate, and whatever the song carries over from the one before it.
+
+BOOL OrganyaStream_Init(void);	// Fails if the audio backend can't play streams
+void OrganyaStream_Deinit(void);
+// Starts rendering a song, abandoning whatever was being rendered before
+void OrganyaStream_Request(const char *path, const ORGANYA_CARRYOVER *carryover);
+
+// The rest must be called with the audio backend locked (see AudioBackend_Lock), and, apart
+// from OrganyaStream_IsReady and OrganyaStream_Seek, inside a batch (see AudioBackend_BeginBatch)
+BOOL OrganyaStream_IsReady(void);	// Whether the last requested song has been rendered
+void OrganyaStream_Start(long x, BOOL looped);	// Starts streaming the last requested song from beat `x`
+void OrganyaStream_Seek(long x, BOOL looped);
+void OrganyaStream_Stop(void);
+void OrganyaStream_SetVolume(long volume);	// In the audio backend's units
@@ -815,6 +815,201 @@ static int Callback_Soundtrack(OptionsMenu *parent_menu, size_t this_option, Cal
 	return return_value;
 }
 
+////////////////
+// Audio menu //
+////////////////
+
+// Returns which of `values` the setting is, or -1 if it's none of them (the config file was edited by hand)
+static long FindOptionValue(const unsigned long *values, size_t total_values, unsigned long setting)
+{
+	for (size_t i = 0; i < total_values; ++i)
+		if (values[i] == setting)
+			return (long)i;
+
+	return -1;
+}
+
+static void StepOptionValue(Option *option, size_t total_values, CallbackAction action)
+{
+	if (action == ACTION_LEFT)
+	{
+		// Decrement value (with wrapping)
+		if (--option->value < 0)
+			option->value = (long)total_values - 1;
+	}
+	else
+	{
+		// Increment value (with wrapping)
+		if (++option->value > (long)total_values - 1)
+			option->value = 0;
+	}
+}
+
+static int Callback_VoiceLimit(OptionsMenu *parent_menu, size_t this_option, CallbackAction action)
+{
+	CONFIGDATA *conf = (CONFIGDATA*)parent_menu->options[this_option].user_data;
+
+	const unsigned long values[] = {0, 8, 16, 32, 64};
+	const char *strings[] = {"Unlimited", "8", "16", "32", "64"};
+
+	switch (action)
+	{
+		case ACTION_INIT:
+			parent_menu->options[this_option].value = FindOptionValue(values, sizeof(values) / sizeof(values[0]), conf->voice_limit);
+			parent_menu->options[this_option].value_string = parent_menu->options[this_option].value < 0 ? "Custom" : strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_DEINIT:
+			if (parent_menu->options[this_option].value >= 0)
+				conf->voice_limit = (unsigned short)values[parent_menu->options[this_option].value];
+
+			break;
+
+		case ACTION_OK:
+		case ACTION_LEFT:
+		case ACTION_RIGHT:
+			StepOptionValue(&parent_menu->options[this_option], sizeof(values) / sizeof(values[0]), action);
+
+			SetSoundVoiceLimit(values[parent_menu->options[this_option].value]);
+
+			PlaySoundObject(SND_SWITCH_WEAPON, SOUND_MODE_PLAY);
+
+			parent_menu->options[this_option].value_string = strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_UPDATE:
+			break;
+	}
+
+	return CALLBACK_CONTINUE;
+}
+
+static int Callback_AudioFrequency(OptionsMenu *parent_menu, size_t this_option, CallbackAction action)
+{
+	CONFIGDATA *conf = (CONFIGDATA*)parent_menu->options[this_option].user_data;
+
+	const unsigned long values[] = {0, 22050, 44100, 48000};
+	const char *strings[] = {"Default", "22050Hz", "44100Hz", "48000Hz"};
+
+	switch (action)
+	{
+		case ACTION_INIT:
+			parent_menu->options[this_option].value = FindOptionValue(values, sizeof(values) / sizeof(values[0]), conf->audio_frequency);
+			parent_menu->options[this_option].value_string = parent_menu->options[this_option].value < 0 ? "Custom" : strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_DEINIT:
+			if (parent_menu->options[this_option].value >= 0)
+				conf->audio_frequency = values[parent_menu->options[this_option].value];
+
+			break;
+
+		case ACTION_OK:
+		case ACTION_LEFT:
+		case ACTION_RIGHT:
+			restart_required = TRUE;
+			parent_menu->subtitle = "RESTART REQUIRED";
+
+			StepOptionValue(&parent_menu->options[this_option], sizeof(values) / sizeof(values[0]), action);
+
+			PlaySoundObject(SND_SWITCH_WEAPON, SOUND_MODE_PLAY);
+
+			parent_menu->options[this_option].value_string = strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_UPDATE:
+			break;
+	}
+
+	return CALLBACK_CONTINUE;
+}
+
+static int Callback_AudioPeriod(OptionsMenu *parent_menu, size_t this_option, CallbackAction action)
+{
+	CONFIGDATA *conf = (CONFIGDATA*)parent_menu->options[this_option].user_data;
+
+	// Smaller buffers mean less latency, but more chance of crackling on slow machines
+	const unsigned long values[] = {0, 256, 512, 1024, 2048};
+	const char *strings[] = {"Default", "256 frames", "512 frames", "1024 frames", "2048 frames"};
+
+	switch (action)
+	{
+		case ACTION_INIT:
+			parent_menu->options[this_option].value = FindOptionValue(values, sizeof(values) / sizeof(values[0]), conf->audio_period);
+			parent_menu->options[this_option].value_string = parent_menu->options[this_option].value < 0 ? "Custom" : strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_DEINIT:
+			if (parent_menu->options[this_option].value >= 0)
+				conf->audio_period = (unsigned short)values[parent_menu->options[this_option].value];
+
+			break;
+
+		case ACTION_OK:
+		case ACTION_LEFT:
+		case ACTION_RIGHT:
+			restart_required = TRUE;
+			parent_menu->subtitle = "RESTART REQUIRED";
+
+			StepOptionValue(&parent_menu->options[this_option], sizeof(values) / sizeof(values[0]), action);
+
+			PlaySoundObject(SND_SWITCH_WEAPON, SOUND_MODE_PLAY);
+
+			parent_menu->options[this_option].value_string = strings[parent_menu->options[this_option].value];
+			break;
+
+		case ACTION_UPDATE:
+			break;
+	}
+
+	return CALLBACK_CONTINUE;
+}
+
+static int Callback_Audio(OptionsMenu *parent_menu, size_t this_option, CallbackAction action)
+{
+	CONFIGDATA *conf = (CONFIGDATA*)parent_menu->options[this_option].user_data;
+
+	if (action != ACTION_OK)
+		return CALLBACK_CONTINUE;
+
+	Option options[] = {
+		{"Voice Limit", Callback_VoiceLimit, conf, NULL, 0, FALSE},
+		{"Output Frequency", Callback_AudioFrequency, conf, NULL, 0, FALSE},
+		{"Output Buffer", Callback_AudioPeriod, conf, NULL, 0, FALSE}
+	};
+
+	OptionsMenu options_menu = {
+		"AUDIO",
+		restart_required ? "RESTART REQUIRED" : NULL,
+		options,
+		sizeof(options) / sizeof(options[0]),
+		-70,
+		TRUE
+	};
+
+	PlaySoundObject(5, SOUND_MODE_PLAY);
+
+	int return_value = EnterOptionsMenu(&options_menu, 0);
+
+	// The options menu needs to say so too
+	if (restart_required)
+		parent_menu->subtitle = "RESTART REQUIRED";
+
+	// Check if we just want to go back to the previous menu
+	if (return_value == CALLBACK_PREVIOUS_MENU)
+	{
+		return_value = CALLBACK_CONTINUE;
+
+		PlaySoundObject(18, SOUND_MODE_PLAY);
+	}
+	else
+	{
+		PlaySoundObject(5, SOUND_MODE_PLAY);
+	}
+
+	return return_value;
+}
+
 //////////////////
 // Options menu //
 //////////////////
@@ -1009,6 +1204,7 @@ static int Callback_Options(OptionsMenu *parent_menu, size_t this_option, Callba
 	#endif
 
 		{"Soundtrack", Callback_Soundtrack, &conf, NULL, 0, FALSE},
+		{"Audio", Callback_Audio, &conf, NULL, 0, FALSE},
 		{"Framerate", Callback_Framerate, &conf, NULL, 0, FALSE},
 
 	#if !defined(__WIIU__) && !defined(_3DS)
@@ -8,6 +8,11 @@
 #include "PixTone.h"
 
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(FIXED_POINT_PIXTONE) || defined(PIXTONE_COMPARISON)
+#include <stdint.h>
+#endif
 #include <string.h>
 
 #include "WindowsWrapper.h"
@@ -72,28 +77,23 @@ void MakeWaveTables(void)
 
 BOOL wave_tables_made;
 
-ATTRIBUTE_HOT BOOL MakePixelWaveData(const PIXTONEPARAMETER *ptp, unsigned char *pData)
+// The Linux port added a cute optimisation here, where MakeWaveTables is only called once during the game's execution.
+// This isn't thread-safe, so it must be called before MakePixelWaveData is used by more than one thread at a time.
+void InitWaveTables(void)
 {
-	int i;
-	int a, b, c, d;
-
-	double dPitch;
-	double dMain;
-	double dVolume;
-
-	double dEnvelope;
-	signed char envelopeTable[0x100];
-
-	double d1, d2, d3;
-
-	// The Linux port added a cute optimisation here, where MakeWaveTables is only called once during the game's execution
 	if (wave_tables_made != TRUE)
 	{
 		MakeWaveTables();
 		wave_tables_made = TRUE;
 	}
+}
+
+static void MakeEnvelopeTable(const PIXTONEPARAMETER *ptp, signed char *envelopeTable)
+{
+	int i;
+	double dEnvelope;
 
-	memset(envelopeTable, 0, sizeof(envelopeTable));
+	memset(envelopeTable, 0, 0x100);
 
 	i = 0;
 
@@ -128,6 +128,190 @@ ATTRIBUTE_HOT BOOL MakePixelWaveData(const PIXTONEPARAMETER *ptp, unsigned char
 		dEnvelope = dEnvelope - (ptp->pointCy / (double)(0x100 - ptp->pointCx));
 		++i;
 	}
+}
+
+#if defined(FIXED_POINT_PIXTONE) || defined(PIXTONE_COMPARISON)
+#define PIXTONE_BLOCK_SIZE 0x100
+
+// An oscillator moves '256 * frequency / size' wave table entries per sample. Rather than rounding
+// that, the phase is kept as a whole number of entries plus an exact fraction, like the resamplers
+// do, so it lands on exactly the entries the maths says it should.
+typedef struct PHASE
+{
+	unsigned int whole;	// Only the bottom 8 bits matter, since the wave tables are 0x100 entries long
+	uint64_t remainder;	// Out of the oscillator's denominator
+} PHASE;
+
+// Splits a frequency into 'numerator / (1 << *shift)'. Frequencies are floats in .pxt files, so 24
+// bits of numerator is enough to hold them exactly. Anything finer than the denominator can hold
+// for this size of sound is rounded, which only happens with absurdly low frequencies.
+static int64_t GetFrequencyFraction(double frequency, int size, int *shift)
+{
+	int exponent;
+	const double mantissa = frexp(frequency, &exponent);
+	int64_t numerator = (int64_t)floor(mantissa * 0x1000000 + 0.5);
+
+	*shift = 24 - exponent;
+
+	while (*shift < 0)
+	{
+		numerator *= 2;
+		++*shift;
+	}
+
+	// The main oscillator's denominator is 'size << (shift + 13)', which has to stay below 1 << 63
+	while (*shift > 0 && (numerator % 2 == 0 || ((uint64_t)size << *shift) >= ((uint64_t)1 << 49)))
+	{
+		numerator = numerator % 2 == 0 ? numerator / 2 : (int64_t)floor(numerator / 2.0 + 0.5);
+		--*shift;
+	}
+
+	return numerator;
+}
+
+static PHASE MakePhaseStep(uint64_t numerator, uint64_t denominator)
+{
+	PHASE step;
+
+	// The numerator is really signed, since a pitch modulator with a big enough 'top' can make the main oscillator go backwards
+	int64_t whole = (int64_t)numerator / (int64_t)denominator;
+	int64_t remainder = (int64_t)numerator % (int64_t)denominator;
+
+	if (remainder < 0)
+	{
+		remainder += denominator;
+		--whole;
+	}
+
+	step.whole = (unsigned int)(whole & 0xFF);
+	step.remainder = (uint64_t)remainder;
+
+	return step;
+}
+
+static void AdvancePhase(PHASE *phase, const PHASE *step, uint64_t denominator)
+{
+	phase->whole += step->whole;
+	phase->remainder += step->remainder;
+
+	if (phase->remainder >= denominator)
+	{
+		phase->remainder -= denominator;
+		++phase->whole;
+	}
+}
+
+// The floating-point version can't be matched exactly: its phases pick up rounding errors as they're
+// added up, so when a phase should land exactly on a wave table entry, it can end up just short of it
+// instead. That's common, since the frequencies are often round numbers, and through the pitch
+// modulator it puts the rest of the sound slightly out of phase. Building the floating-point version
+// with 'long double' phases changes its output just as much (see pxtcompare).
+static void MakeFixedPointWaveData(const PIXTONEPARAMETER *ptp, const signed char *envelopeTable, unsigned char *pData)
+{
+	int i, j;
+	int block_size;
+	int envelope_position;
+	int envelope_remainder;
+	int main_shift, pitch_shift, volume_shift;
+
+	PHASE main_phase, pitch_phase, volume_phase;
+	PHASE pitch_step, volume_step;
+	PHASE main_steps[0x100];	// How far the main oscillator moves, for each point in the pitch modulator's wave
+	int main_amplitudes[0x100];
+	int volume_factors[0x100];
+
+	unsigned char main_indices[PIXTONE_BLOCK_SIZE];
+	unsigned char pitch_indices[PIXTONE_BLOCK_SIZE];
+	unsigned char volume_indices[PIXTONE_BLOCK_SIZE];
+	unsigned char envelope_indices[PIXTONE_BLOCK_SIZE];
+
+	const int64_t main_numerator = GetFrequencyFraction(ptp->oMain.num, ptp->size, &main_shift);
+	const int64_t pitch_numerator = GetFrequencyFraction(ptp->oPitch.num, ptp->size, &pitch_shift);
+	const int64_t volume_numerator = GetFrequencyFraction(ptp->oVolume.num, ptp->size, &volume_shift);
+
+	// The pitch modulator scales the main oscillator's frequency by 'K / 0x2000'
+	const uint64_t main_denominator = (uint64_t)ptp->size << (main_shift + 13);
+	const uint64_t pitch_denominator = (uint64_t)ptp->size << pitch_shift;
+	const uint64_t volume_denominator = (uint64_t)ptp->size << volume_shift;
+
+	for (i = 0; i < 0x100; ++i)
+	{
+		const int64_t wave = gWaveModelTable[ptp->oPitch.model][i];
+		const int64_t k = wave < 0 ? 0x2000 + wave * ptp->oPitch.top : 0x2000 + 4 * wave * ptp->oPitch.top;
+
+		main_steps[i] = MakePhaseStep((uint64_t)main_numerator * 0x100 * (uint64_t)k, main_denominator);
+		main_amplitudes[i] = gWaveModelTable[ptp->oMain.model][i] * ptp->oMain.top / 64;
+		volume_factors[i] = ((gWaveModelTable[ptp->oVolume.model][i] * ptp->oVolume.top) / 64) + 64;
+	}
+
+	pitch_step = MakePhaseStep((uint64_t)pitch_numerator * 0x100, pitch_denominator);
+	volume_step = MakePhaseStep((uint64_t)volume_numerator * 0x100, volume_denominator);
+
+	main_phase.whole = ptp->oMain.offset;
+	main_phase.remainder = 0;
+	pitch_phase.whole = ptp->oPitch.offset;
+	pitch_phase.remainder = 0;
+	volume_phase.whole = ptp->oVolume.offset;
+	volume_phase.remainder = 0;
+
+	// The envelope index is 'i * 0x100 / ptp->size', stepped along without dividing
+	envelope_position = 0;
+	envelope_remainder = 0;
+
+	for (i = 0; i < ptp->size; i += block_size)
+	{
+		block_size = ptp->size - i < PIXTONE_BLOCK_SIZE ? ptp->size - i : PIXTONE_BLOCK_SIZE;
+
+		// The pitch and volume modulators and the envelope only depend on where the sound is up to...
+		for (j = 0; j < block_size; ++j)
+		{
+			pitch_indices[j] = (unsigned char)pitch_phase.whole;
+			AdvancePhase(&pitch_phase, &pitch_step, pitch_denominator);
+		}
+
+		for (j = 0; j < block_size; ++j)
+		{
+			volume_indices[j] = (unsigned char)volume_phase.whole;
+			AdvancePhase(&volume_phase, &volume_step, volume_denominator);
+		}
+
+		for (j = 0; j < block_size; ++j)
+		{
+			envelope_indices[j] = (unsigned char)envelope_position;
+
+			envelope_remainder += 0x100;
+			while (envelope_remainder >= ptp->size)
+			{
+				envelope_remainder -= ptp->size;
+				++envelope_position;
+			}
+		}
+
+		// ...while the pitch modulator feeds into the main oscillator
+		for (j = 0; j < block_size; ++j)
+		{
+			main_indices[j] = (unsigned char)main_phase.whole;
+			AdvancePhase(&main_phase, &main_steps[pitch_indices[j]], main_denominator);
+		}
+
+		// The samples themselves don't depend on each other, so they can be made in bulk
+		for (j = 0; j < block_size; ++j)
+			pData[i + j] = main_amplitudes[main_indices[j]] * volume_factors[volume_indices[j]] / 64 * envelopeTable[envelope_indices[j]] / 64 + 128;
+	}
+}
+#endif
+
+#if !defined(FIXED_POINT_PIXTONE) || defined(PIXTONE_COMPARISON)
+static void MakeFloatingPointWaveData(const PIXTONEPARAMETER *ptp, const signed char *envelopeTable, unsigned char *pData)
+{
+	int i;
+	int a, b, c, d;
+
+	double dPitch;
+	double dMain;
+	double dVolume;
+
+	double d1, d2, d3;
 
 	dPitch = ptp->oPitch.offset;
 	dMain = ptp->oMain.offset;
@@ -171,6 +355,119 @@ ATTRIBUTE_HOT BOOL MakePixelWaveData(const PIXTONEPARAMETER *ptp, unsigned char
 		dPitch += d2;
 		dVolume += d3;
 	}
+}
+#endif
+
+ATTRIBUTE_HOT BOOL MakePixelWaveData(const PIXTONEPARAMETER *ptp, unsigned char *pData)
+{
+	signed char envelopeTable[0x100];
+
+	InitWaveTables();
+
+	MakeEnvelopeTable(ptp, envelopeTable);
+
+#ifdef FIXED_POINT_PIXTONE
+	MakeFixedPointWaveData(ptp, envelopeTable, pData);
+#else
+	MakeFloatingPointWaveData(ptp, envelopeTable, pData);
+#endif
+
+	return TRUE;
+}
+
+#ifdef PIXTONE_COMPARISON
+BOOL MakePixelWaveData_Kernel(const PIXTONEPARAMETER *ptp, unsigned char *pData, BOOL fixed_point)
+{
+	signed char envelopeTable[0x100];
+
+	InitWaveTables();
+
+	MakeEnvelopeTable(ptp, envelopeTable);
+
+	if (fixed_point)
+		MakeFixedPointWaveData(ptp, envelopeTable, pData);
+	else
+		MakeFloatingPointWaveData(ptp, envelopeTable, pData);
 
 	return TRUE;
 }
+#endif
+
+// Original decompiled from `PTone103.exe` - has since been modified
+BOOL LoadPixToneFile(const char *filename, PIXTONEPARAMETER *pixtone_parameters)
+{
+	BOOL success = FALSE;
+
+	FILE *fp = fopen(filename, "r");
+
+	if (fp != NULL)
+	{
+		fseek(fp, 0, SEEK_END);
+		const size_t file_size = ftell(fp);
+		rewind(fp);
+
+		char *file_buffer = (char*)malloc(file_size);
+		fread(file_buffer, 1, file_size, fp);
+
+		fclose(fp);
+
+		char *p = file_buffer;
+
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			float freq;
+			int increment;
+			sscanf(p, "use  :%d\n%n", &pixtone_parameters[i].use, &increment);
+			p += increment;
+			sscanf(p, "size :%d\n%n", &pixtone_parameters[i].size, &increment);
+			p += increment;
+			sscanf(p, "main_model   :%d\n%n", &pixtone_parameters[i].oMain.model, &increment);
+			p += increment;
+			sscanf(p, "main_freq    :%f\n%n", &freq, &increment);
+			p += increment;
+			pixtone_parameters[i].oMain.num = freq;
+			sscanf(p, "main_top     :%d\n%n", &pixtone_parameters[i].oMain.top, &increment);
+			p += increment;
+			sscanf(p, "main_offset  :%d\n%n", &pixtone_parameters[i].oMain.offset, &increment);
+			p += increment;
+			sscanf(p, "pitch_model  :%d\n%n", &pixtone_parameters[i].oPitch.model, &increment);
+			p += increment;
+			sscanf(p, "pitch_freq   :%f\n%n", &freq, &increment);
+			p += increment;
+			pixtone_parameters[i].oPitch.num = freq;
+			sscanf(p, "pitch_top    :%d\n%n", &pixtone_parameters[i].oPitch.top, &increment);
+			p += increment;
+			sscanf(p, "pitch_offset :%d\n%n", &pixtone_parameters[i].oPitch.offset, &increment);
+			p += increment;
+			sscanf(p, "volume_model :%d\n%n", &pixtone_parameters[i].oVolume.model, &increment);
+			p += increment;
+			sscanf(p, "volume_freq  :%f\n%n", &freq, &increment);
+			p += increment;
+			pixtone_parameters[i].oVolume.num = freq;
+			sscanf(p, "volume_top   :%d\n%n", &pixtone_parameters[i].oVolume.top, &increment);
+			p += increment;
+			sscanf(p, "volume_offset:%d\n%n", &pixtone_parameters[i].oVolume.offset, &increment);
+			p += increment;
+			sscanf(p, "initialY:%d\n%n", &pixtone_parameters[i].initial, &increment);
+			p += increment;
+			sscanf(p, "ax      :%d\n%n", &pixtone_parameters[i].pointAx, &increment);
+			p += increment;
+			sscanf(p, "ay      :%d\n%n", &pixtone_parameters[i].pointAy, &increment);
+			p += increment;
+			sscanf(p, "bx      :%d\n%n", &pixtone_parameters[i].pointBx, &increment);
+			p += increment;
+			sscanf(p, "by      :%d\n%n", &pixtone_parameters[i].pointBy, &increment);
+			p += increment;
+			sscanf(p, "cx      :%d\n%n", &pixtone_parameters[i].pointCx, &increment);
+			p += increment;
+			sscanf(p, "cy      :%d\n\n%n", &pixtone_parameters[i].pointCy, &increment);
+			p += increment;
+		}
+
+		free(file_buffer);
+
+		success = TRUE;
+	}
+
+	return success;
+}
@@ -36,4 +36,10 @@ typedef struct PIXTONEPARAMETER
 extern signed char gWaveModelTable[6][0x100];
 
 void MakeWaveTables(void);
+void InitWaveTables(void);
 BOOL MakePixelWaveData(const PIXTONEPARAMETER *ptp, unsigned char *pData);
+BOOL LoadPixToneFile(const char *filename, PIXTONEPARAMETER *pixtone_parameters);
+
+#ifdef PIXTONE_COMPARISON
+BOOL MakePixelWaveData_Kernel(const PIXTONEPARAMETER *ptp, unsigned char *pData, BOOL fixed_point);	// For pxtcompare, which checks the fixed-point kernel against the floating-point one
+#endif
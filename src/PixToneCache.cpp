@@ -0,0 +1,347 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Synthesised PixTone sounds are saved to a file next to the executable, so that they don't
+// need to be synthesised again the next time the game is launched. Sounds are looked up by
+// their parameters rather than by filename, so editing a .pxt file just makes it miss the
+// cache, and the stale sound is dropped the next time the cache is saved.
+
+#include "PixToneCache.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "WindowsWrapper.h"
+
+#include "Backends/Misc.h"
+#include "File.h"
+#include "Main.h"
+#include "PixTone.h"
+
+// Change the last character whenever the synthesiser's output changes, so that old caches are thrown away
+#ifdef FIXED_POINT_PIXTONE
+static const char cache_magic[8] = {'P', 'X', 'T', 'C', 'A', 'C', 'H', 'G'};
+#else
+static const char cache_magic[8] = {'P', 'X', 'T', 'C', 'A', 'C', 'H', '1'};
+#endif
+static const char* const cache_name = "PixToneCache.dat";
+
+#define CHANNEL_KEY_SIZE (18 * 4 + 3 * 8)	// 18 ints and 3 doubles
+#define MAX_KEY_SIZE (CHANNEL_KEY_SIZE * 4)
+
+typedef struct CacheEntry
+{
+	unsigned char key[MAX_KEY_SIZE];
+	size_t key_size;
+	unsigned char *samples;	// Either points into file_buffer, or was allocated by PixToneCache_Add
+	size_t sample_count;
+	BOOL owns_samples;
+	BOOL used;	// Only sounds that were used this session get saved
+} CacheEntry;
+
+static CacheEntry *entries;
+static size_t total_entries;
+static size_t entry_capacity;
+
+static unsigned char *file_buffer;
+static Backend_Mutex *cache_mutex;	// Sounds are synthesised from multiple threads at startup
+static BOOL cache_dirty;
+
+static unsigned char* WriteKeyInt(unsigned char *p, long value)
+{
+	const unsigned long u = (unsigned long)value;
+
+	p[0] = (unsigned char)u;
+	p[1] = (unsigned char)(u >> 8);
+	p[2] = (unsigned char)(u >> 16);
+	p[3] = (unsigned char)(u >> 24);
+
+	return p + 4;
+}
+
+static unsigned char* WriteKeyDouble(unsigned char *p, double value)
+{
+	unsigned char bytes[8];
+	unsigned int i;
+
+	memcpy(bytes, &value, sizeof(bytes));
+
+	// Store it in a consistent byte order
+	const unsigned short endian_test = 1;
+	if (*(const unsigned char*)&endian_test)
+		for (i = 0; i < 8; ++i)
+			p[i] = bytes[i];
+	else
+		for (i = 0; i < 8; ++i)
+			p[i] = bytes[7 - i];
+
+	return p + 8;
+}
+
+static unsigned char* WriteKeyOscillator(unsigned char *p, const PIXTONEPARAMETER2 *oscillator)
+{
+	p = WriteKeyInt(p, oscillator->model);
+	p = WriteKeyDouble(p, oscillator->num);
+	p = WriteKeyInt(p, oscillator->top);
+	p = WriteKeyInt(p, oscillator->offset);
+
+	return p;
+}
+
+// Flattens the parameters into a byte string, without any of the structs' padding
+static size_t MakeKey(unsigned char *key, const PIXTONEPARAMETER *ptp, int ptp_num)
+{
+	unsigned char *p = key;
+
+	for (int i = 0; i < ptp_num; ++i)
+	{
+		p = WriteKeyInt(p, ptp[i].use);
+		p = WriteKeyInt(p, ptp[i].size);
+		p = WriteKeyOscillator(p, &ptp[i].oMain);
+		p = WriteKeyOscillator(p, &ptp[i].oPitch);
+		p = WriteKeyOscillator(p, &ptp[i].oVolume);
+		p = WriteKeyInt(p, ptp[i].initial);
+		p = WriteKeyInt(p, ptp[i].pointAx);
+		p = WriteKeyInt(p, ptp[i].pointAy);
+		p = WriteKeyInt(p, ptp[i].pointBx);
+		p = WriteKeyInt(p, ptp[i].pointBy);
+		p = WriteKeyInt(p, ptp[i].pointCx);
+		p = WriteKeyInt(p, ptp[i].pointCy);
+	}
+
+	return p - key;
+}
+
+static CacheEntry* FindEntry(const unsigned char *key, size_t key_size)
+{
+	for (size_t i = 0; i < total_entries; ++i)
+		if (entries[i].key_size == key_size && memcmp(entries[i].key, key, key_size) == 0)
+			return &entries[i];
+
+	return NULL;
+}
+
+static CacheEntry* NewEntry(void)
+{
+	if (total_entries == entry_capacity)
+	{
+		const size_t new_capacity = entry_capacity == 0 ? 0x100 : entry_capacity * 2;
+		CacheEntry *new_entries = (CacheEntry*)realloc(entries, new_capacity * sizeof(CacheEntry));
+
+		if (new_entries == NULL)
+			return NULL;
+
+		entries = new_entries;
+		entry_capacity = new_capacity;
+	}
+
+	return &entries[total_entries++];
+}
+
+static unsigned long ReadLE32(const unsigned char *p)
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+void PixToneCache_Load(void)
+{
+	size_t file_size;
+
+	cache_mutex = Backend_CreateMutex();
+
+	std::string path = gModulePath + '/' + cache_name;
+
+	file_buffer = LoadFileToMemory(path.c_str(), &file_size);
+
+	if (file_buffer == NULL)
+		return;
+
+	if (file_size < sizeof(cache_magic) + 4 || memcmp(file_buffer, cache_magic, sizeof(cache_magic)) != 0)
+	{
+		free(file_buffer);
+		file_buffer = NULL;
+		return;
+	}
+
+	const unsigned char *p = file_buffer + sizeof(cache_magic);
+	const unsigned char *file_end = file_buffer + file_size;
+
+	unsigned long count = ReadLE32(p);
+	p += 4;
+
+	// If the file is truncated, just keep whatever could be read
+	while (count-- != 0)
+	{
+		if (file_end - p < 8)
+			break;
+
+		const size_t key_size = ReadLE32(p);
+		const size_t sample_count = ReadLE32(p + 4);
+		p += 8;
+
+		if (key_size > MAX_KEY_SIZE || (size_t)(file_end - p) < key_size + sample_count)
+			break;
+
+		CacheEntry *entry = NewEntry();
+
+		if (entry == NULL)
+			break;
+
+		memcpy(entry->key, p, key_size);
+		entry->key_size = key_size;
+		entry->samples = (unsigned char*)p + key_size;
+		entry->sample_count = sample_count;
+		entry->owns_samples = FALSE;
+		entry->used = FALSE;
+
+		p += key_size + sample_count;
+	}
+}
+
+void PixToneCache_Save(void)
+{
+	size_t i;
+	unsigned long count;
+
+	Backend_LockMutex(cache_mutex);
+
+	if (cache_dirty)
+	{
+		std::string path = gModulePath + '/' + cache_name;
+
+		FILE *fp = fopen(path.c_str(), "wb");
+
+		if (fp != NULL)
+		{
+			count = 0;
+			for (i = 0; i < total_entries; ++i)
+				if (entries[i].used)
+					++count;
+
+			fwrite(cache_magic, sizeof(cache_magic), 1, fp);
+			File_WriteLE32(count, fp);
+
+			for (i = 0; i < total_entries; ++i)
+			{
+				if (entries[i].used)
+				{
+					File_WriteLE32((unsigned long)entries[i].key_size, fp);
+					File_WriteLE32((unsigned long)entries[i].sample_count, fp);
+					fwrite(entries[i].key, entries[i].key_size, 1, fp);
+					fwrite(entries[i].samples, entries[i].sample_count, 1, fp);
+				}
+			}
+
+			fclose(fp);
+		}
+
+		cache_dirty = FALSE;
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+}
+
+void PixToneCache_Free(void)
+{
+	for (size_t i = 0; i < total_entries; ++i)
+		if (entries[i].owns_samples)
+			free(entries[i].samples);
+
+	free(entries);
+	entries = NULL;
+	total_entries = 0;
+	entry_capacity = 0;
+
+	free(file_buffer);
+	file_buffer = NULL;
+
+	Backend_DestroyMutex(cache_mutex);
+	cache_mutex = NULL;
+
+	cache_dirty = FALSE;
+}
+
+unsigned char* PixToneCache_Find(const PIXTONEPARAMETER *ptp, int ptp_num, int *sample_count)
+{
+	unsigned char key[MAX_KEY_SIZE];
+	unsigned char *samples = NULL;
+
+	if (ptp_num < 0 || ptp_num > 4)
+		return NULL;
+
+	const size_t key_size = MakeKey(key, ptp, ptp_num);
+
+	Backend_LockMutex(cache_mutex);
+
+	CacheEntry *entry = FindEntry(key, key_size);
+
+	if (entry != NULL)
+	{
+		samples = (unsigned char*)malloc(entry->sample_count);
+
+		if (samples != NULL)
+		{
+			memcpy(samples, entry->samples, entry->sample_count);
+			*sample_count = (int)entry->sample_count;
+
+			// If the cache has already been saved without this sound, it needs saving again
+			if (!entry->used)
+			{
+				entry->used = TRUE;
+				cache_dirty = TRUE;
+			}
+		}
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+
+	return samples;
+}
+
+void PixToneCache_Add(const PIXTONEPARAMETER *ptp, int ptp_num, const unsigned char *samples, int sample_count)
+{
+	unsigned char key[MAX_KEY_SIZE];
+
+	if (ptp_num < 0 || ptp_num > 4 || sample_count <= 0)
+		return;
+
+	const size_t key_size = MakeKey(key, ptp, ptp_num);
+
+	unsigned char *samples_copy = (unsigned char*)malloc(sample_count);
+
+	if (samples_copy == NULL)
+		return;
+
+	memcpy(samples_copy, samples, sample_count);
+
+	Backend_LockMutex(cache_mutex);
+
+	CacheEntry *entry = FindEntry(key, key_size);
+
+	// Another thread might have made the same sound in the meantime
+	if (entry == NULL)
+	{
+		entry = NewEntry();
+
+		if (entry != NULL)
+		{
+			memcpy(entry->key, key, key_size);
+			entry->key_size = key_size;
+			entry->samples = samples_copy;
+			entry->sample_count = sample_count;
+			entry->owns_samples = TRUE;
+			entry->used = TRUE;
+
+			samples_copy = NULL;
+
+			cache_dirty = TRUE;
+		}
+	}
+
+	Backend_UnlockMutex(cache_mutex);
+
+	free(samples_copy);
+}
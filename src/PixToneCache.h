@@ -0,0 +1,12 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include "PixTone.h"
+
+void PixToneCache_Load(void);
+void PixToneCache_Save(void);
+void PixToneCache_Free(void);
+unsigned char* PixToneCache_Find(const PIXTONEPARAMETER *ptp, int ptp_num, int *sample_count);	// Returns a copy that the caller must free, or NULL if the sound isn't cached
+void PixToneCache_Add(const PIXTONEPARAMETER *ptp, int ptp_num, const unsigned char *samples, int sample_count);
@@ -28,23 +28,27 @@ equivalents.
 #include "WindowsWrapper.h"
 
 #include "Backends/Audio.h"
+#include "Backends/Misc.h"
 #ifdef EXTRA_SOUND_FORMATS
 #include "ExtraSoundFormats.h"
 #endif
 #include "Main.h"
 #include "Organya.h"
 #include "PixTone.h"
+#ifdef PIXTONE_CACHE
+#include "PixToneCache.h"
+#endif
 #include "Resource.h"
 
 BOOL audio_backend_initialised;
 AudioBackend_Sound *lpSECONDARYBUFFER[SE_MAX];
 
 // DirectSoundの開始 (Starting DirectSound)
-BOOL InitDirectSound(void)
+BOOL InitDirectSound(unsigned long frequency, unsigned int period)
 {
 	int i;
 
-	audio_backend_initialised = AudioBackend_Init();
+	audio_backend_initialised = AudioBackend_Init(frequency, period);
 
 	if (!audio_backend_initialised)
 	{
@@ -60,6 +64,17 @@ BOOL InitDirectSound(void)
 
 	StartOrganya("Org/Wave.dat");
 
+#ifdef PIXTONE_CACHE
+	PixToneCache_Load();
+#endif
+
+#ifdef EXTRA_SOUND_FORMATS
+	unsigned long output_frequency;
+	size_t output_period;
+	AudioBackend_GetOutputFormat(&output_frequency, &output_period);
+	ExtraSound_Init(output_frequency);
+#endif
+
 	return TRUE;
 }
 
@@ -73,6 +88,21 @@ void EndDirectSound(void)
 
 	EndOrganya();
 
+#ifdef EXTRA_SOUND_FORMATS
+	if (ExtraSound_GetUnderrunCount() != 0)
+		Backend_PrintInfo("Music decoding fell behind %lu times", ExtraSound_GetUnderrunCount());
+
+	ExtraSound_Deinit();
+#endif
+
+#ifdef PIXTONE_CACHE
+	PixToneCache_Save();
+	PixToneCache_Free();
+#endif
+
+	if (AudioBackend_GetStolenVoiceCount() != 0)
+		Backend_PrintInfo("%lu sounds were cut off by the voice limit", AudioBackend_GetStolenVoiceCount());
+
 	for (i = 0; i < SE_MAX; i++)
 		if (lpSECONDARYBUFFER[i] != NULL)
 			AudioBackend_DestroySound(lpSECONDARYBUFFER[i]);
@@ -302,7 +332,9 @@ void ChangeSoundPan(int no, long pan)	// 512がMAXで256がﾉｰﾏﾙ (512 is
 }
 
 // TODO - The stack frame for this function is inaccurate
-int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
+// Synthesises a PixTone sound without registering it, so it can be done on any thread.
+// The caller must free the returned buffer.
+unsigned char* MakePixToneData(const PIXTONEPARAMETER *ptp, int ptp_num, int *sample_count_out)
 {
 	int sample_count;
 	int i, j;
@@ -310,8 +342,12 @@ int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
 	unsigned char *pcm_buffer;
 	unsigned char *mixed_pcm_buffer;
 
-	if (!audio_backend_initialised)
-		return 0;
+#ifdef PIXTONE_CACHE
+	mixed_pcm_buffer = PixToneCache_Find(ptp, ptp_num, sample_count_out);
+
+	if (mixed_pcm_buffer != NULL)
+		return mixed_pcm_buffer;
+#endif
 
 	ptp_pointer = ptp;
 	sample_count = 0;
@@ -337,7 +373,7 @@ int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
 		if (mixed_pcm_buffer != NULL)
 			free(mixed_pcm_buffer);
 
-		return -1;
+		return NULL;
 	}
 
 	memset(pcm_buffer, 0x80, sample_count);
@@ -355,7 +391,7 @@ int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
 			if (mixed_pcm_buffer != NULL) // This is always true
 				free(mixed_pcm_buffer);
 
-			return -1;
+			return NULL;
 		}
 
 		for (j = 0; j < ptp_pointer->size; j++)
@@ -375,16 +411,57 @@ int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
 	mixed_pcm_buffer[0] = mixed_pcm_buffer[0];
 	mixed_pcm_buffer[sample_count - 1] = mixed_pcm_buffer[sample_count - 1];
 
-	lpSECONDARYBUFFER[no] = AudioBackend_CreateSound(22050, mixed_pcm_buffer, sample_count);
+	free(pcm_buffer);
 
-	if (pcm_buffer != NULL)
-		free(pcm_buffer);
+#ifdef PIXTONE_CACHE
+	PixToneCache_Add(ptp, ptp_num, mixed_pcm_buffer, sample_count);
+#endif
 
-	if (mixed_pcm_buffer != NULL)
-		free(mixed_pcm_buffer);
+	*sample_count_out = sample_count;
+
+	return mixed_pcm_buffer;
+}
+
+// Registers a sound made by MakePixToneData
+int MakePixToneObjectFromData(const unsigned char *data, int sample_count, int no)
+{
+	if (!audio_backend_initialised)
+		return 0;
+
+	lpSECONDARYBUFFER[no] = AudioBackend_CreateSound(22050, data, sample_count);
 
 	if (lpSECONDARYBUFFER[no] == NULL)
 		return -1;
 
 	return sample_count;
 }
+
+int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no)
+{
+	int sample_count;
+	unsigned char *data;
+	int result;
+
+	if (!audio_backend_initialised)
+		return 0;
+
+	data = MakePixToneData(ptp, ptp_num, &sample_count);
+
+	if (data == NULL)
+		return -1;
+
+	result = MakePixToneObjectFromData(data, sample_count, no);
+
+	free(data);
+
+	return result;
+}
+
+// Limits how many sounds (including Organya's instruments) can play at once
+void SetSoundVoiceLimit(unsigned int voices)
+{
+	if (!audio_backend_initialised)
+		return;
+
+	AudioBackend_SetVoiceLimit(voices);
+}
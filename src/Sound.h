@@ -43,7 +43,7 @@ enum SoundMode
 extern BOOL audio_backend_initialised;
 extern AudioBackend_Sound *lpSECONDARYBUFFER[SE_MAX];
 
-BOOL InitDirectSound(void);
+BOOL InitDirectSound(unsigned long frequency, unsigned int period);
 void EndDirectSound(void);
 BOOL InitSoundObject(const char *resname, int no);
 BOOL LoadSoundObject(const char *file_name, int no);
@@ -51,4 +51,7 @@ void PlaySoundObject(int no, SoundMode mode);
 void ChangeSoundFrequency(int no, unsigned long rate);
 void ChangeSoundVolume(int no, long volume);
 void ChangeSoundPan(int no, long pan);
+unsigned char* MakePixToneData(const PIXTONEPARAMETER *ptp, int ptp_num, int *sample_count_out);
+int MakePixToneObjectFromData(const unsigned char *data, int sample_count, int no);
 int MakePixToneObject(const PIXTONEPARAMETER *ptp, int ptp_num, int no);
+void SetSoundVoiceLimit(unsigned int voices);
@@ -710,6 +710,30 @@ void ChangeMusic(MusicID no)
 	gMusicNo = no;
 }
 
+// Starts loading a song that's likely to be played soon, so that ChangeMusic can switch to it without a gap
+void PrefetchMusic(MusicID no)
+{
+#ifdef EXTRA_SOUND_FORMATS
+	const MusicListEntry *music_table = soundtracks[gSoundtrack].music_table;
+
+	// The number comes from a script, so it might not be a real song
+	if ((unsigned int)no >= sizeof(music_table_organya) / sizeof(music_table_organya[0]) || no == gMusicNo || music_table[no].type != MUSIC_TYPE_OTHER)
+		return;
+
+	std::string intro_file_path;
+	if (music_table[no].intro_file_path != NULL)
+		intro_file_path = gDataPath + '/' + music_table[no].intro_file_path;
+
+	std::string loop_file_path;
+	if (music_table[no].loop_file_path != NULL)
+		loop_file_path = gDataPath + '/' + music_table[no].loop_file_path;
+
+	ExtraSound_PrefetchMusic(music_table[no].intro_file_path != NULL ? intro_file_path.c_str() : NULL, music_table[no].loop_file_path != NULL ? loop_file_path.c_str() : NULL, music_table[no].loop);
+#else
+	(void)no;
+#endif
+}
+
 void ReCallMusic(void)
 {
 	std::string path;
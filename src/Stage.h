@@ -78,5 +78,6 @@ extern const STAGE_TABLE *gTMT;
 BOOL LoadStageTable();
 BOOL TransferStage(int no, int w, int x, int y);
 void ChangeMusic(MusicID no);
+void PrefetchMusic(MusicID no);
 void ReCallMusic(void);
 BOOL CheckSoundtrackExists(int soundtrack);
@@ -231,6 +231,30 @@ int GetTextScriptNo(int a)
 	return b;
 }
 
+#ifdef EXTRA_SOUND_FORMATS
+// Looks ahead through the event that's starting for a <CMU, so that its song can be loaded while the event plays out
+static void PrefetchEventMusic(void)
+{
+	for (int p = gTS.p_read; gTS.data[p] != '\0'; ++p)
+	{
+		// The next event starts on a line of its own
+		if (gTS.data[p] == '#' && gTS.data[p - 1] == '\n')
+			break;
+
+		if (gTS.data[p] == '<' && gTS.data[p + 1] == 'C' && gTS.data[p + 2] == 'M' && gTS.data[p + 3] == 'U')
+		{
+			// Don't read the number past the end of a truncated script
+			for (int i = 4; i < 8; ++i)
+				if (gTS.data[p + i] == '\0')
+					return;
+
+			PrefetchMusic((MusicID)GetTextScriptNo(p + 4));
+			break;
+		}
+	}
+}
+#endif
+
 // Start TSC event
 BOOL StartTextScript(int no)
 {
@@ -292,6 +316,10 @@ BOOL StartTextScript(int no)
 		++gTS.p_read;
 	++gTS.p_read;
 
+#ifdef EXTRA_SOUND_FORMATS
+	PrefetchEventMusic();
+#endif
+
 	return TRUE;
 }
 
@@ -345,6 +373,10 @@ BOOL JumpTextScript(int no)
 
 	++gTS.p_read;
 
+#ifdef EXTRA_SOUND_FORMATS
+	PrefetchEventMusic();
+#endif
+
 	return TRUE;
 }
 
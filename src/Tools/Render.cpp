@@ -0,0 +1,167 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#include "Render.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#include "../WindowsWrapper.h"
+
+#include "../Backends/Audio/SoftwareMixer/Offline.h"
+#include "../Main.h"
+#include "../PixTone.h"
+#include "../Resource.h"
+#include "../Sound.h"
+
+#define RENDER_PERIOD 0x400	// Frames rendered at a time
+
+std::string gModulePath;
+std::string gDataPath;
+
+static unsigned long render_sample_rate;
+
+// Sound.cpp uses this for the game's embedded sounds, which the tools don't have
+const unsigned char* FindResource(const char *name, const char *type, size_t *size)
+{
+	(void)name;
+	(void)type;
+	(void)size;
+
+	return NULL;
+}
+
+BOOL Render_Init(const char *argv0, const char *data_path, unsigned long sample_rate)
+{
+	// Find the executable's folder, like the game does when the platform backend can't
+	gModulePath = argv0;
+
+	for (size_t i = gModulePath.length();; --i)
+	{
+		if (i == 0 || gModulePath[i] == '\\' || gModulePath[i] == '/')
+		{
+			gModulePath.resize(i);
+			break;
+		}
+	}
+
+	if (data_path != NULL)
+		gDataPath = data_path;
+	else
+		gDataPath = gModulePath + "/data";
+
+	render_sample_rate = sample_rate;
+
+	if (!InitDirectSound(sample_rate, RENDER_PERIOD))
+	{
+		fprintf(stderr, "Could not start the audio mixer\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void Render_Deinit(void)
+{
+	EndDirectSound();
+}
+
+// Loads a .pxt file into a sound slot, the same way LoadGenericData does
+int Render_LoadPixTone(const char *path, int no)
+{
+	PIXTONEPARAMETER pixtone_parameters[4];
+
+	memset(pixtone_parameters, 0, sizeof(pixtone_parameters));
+
+	if (!LoadPixToneFile(path, pixtone_parameters))
+		return 0;
+
+	int ptp_num = 0;
+	while (ptp_num < 4 && pixtone_parameters[ptp_num].use)
+		++ptp_num;
+
+	return MakePixToneObject(pixtone_parameters, ptp_num, no);
+}
+
+static void WriteLE16(unsigned char *p, unsigned short value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+}
+
+static void WriteLE32(unsigned char *p, unsigned long value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+	p[2] = (unsigned char)(value >> 16);
+	p[3] = (unsigned char)(value >> 24);
+}
+
+// Renders `frames` frames of whatever is playing to a 16-bit stereo WAV file
+BOOL Render_ToWAV(const char *path, size_t frames)
+{
+	short stream[RENDER_PERIOD * 2];
+	unsigned char bytes[RENDER_PERIOD * 2 * 2];
+	unsigned char header[44];
+
+	FILE *file = fopen(path, "wb");
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open '%s' for writing\n", path);
+		return FALSE;
+	}
+
+	const unsigned long data_size = (unsigned long)frames * 2 * 2;
+
+	memcpy(&header[0], "RIFF", 4);
+	WriteLE32(&header[4], 36 + data_size);
+	memcpy(&header[8], "WAVE", 4);
+	memcpy(&header[12], "fmt ", 4);
+	WriteLE32(&header[16], 16);
+	WriteLE16(&header[20], 1);	// PCM
+	WriteLE16(&header[22], 2);	// Channels
+	WriteLE32(&header[24], render_sample_rate);
+	WriteLE32(&header[28], render_sample_rate * 2 * 2);	// Bytes per second
+	WriteLE16(&header[32], 2 * 2);	// Bytes per frame
+	WriteLE16(&header[34], 16);	// Bits per sample
+	memcpy(&header[36], "data", 4);
+	WriteLE32(&header[40], data_size);
+
+	fwrite(header, sizeof(header), 1, file);
+
+	const clock_t start_time = clock();
+
+	for (size_t frames_done = 0; frames_done < frames;)
+	{
+		const size_t frames_to_do = frames - frames_done < RENDER_PERIOD ? frames - frames_done : RENDER_PERIOD;
+
+		SoftwareMixerBackend_Render(stream, frames_to_do);
+
+		for (size_t i = 0; i < frames_to_do * 2; ++i)
+			WriteLE16(&bytes[i * 2], (unsigned short)stream[i]);
+
+		fwrite(bytes, frames_to_do * 2 * 2, 1, file);
+
+		frames_done += frames_to_do;
+	}
+
+	const double seconds_taken = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+	const double seconds_rendered = (double)frames / render_sample_rate;
+
+	if (fclose(file) != 0)
+	{
+		fprintf(stderr, "Could not write '%s'\n", path);
+		return FALSE;
+	}
+
+	if (seconds_taken > 0.0)
+		printf("Rendered %.2fs of audio in %.3fs (%.1fx realtime)\n", seconds_rendered, seconds_taken, seconds_rendered / seconds_taken);
+	else
+		printf("Rendered %.2fs of audio in no measurable time\n", seconds_rendered);
+
+	return TRUE;
+}
@@ -0,0 +1,16 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "../WindowsWrapper.h"
+
+// Shared by org2wav and pxt2wav, which render audio through the game's own
+// Organya, PixTone and software mixer code, without needing an audio device.
+
+BOOL Render_Init(const char *argv0, const char *data_path, unsigned long sample_rate);	// `data_path` can be NULL, for the 'data' folder next to the executable
+void Render_Deinit(void);
+int Render_LoadPixTone(const char *path, int no);	// Returns the sound's length in samples, or 0 or less if it couldn't be loaded
+BOOL Render_ToWAV(const char *path, size_t frames);
@@ -0,0 +1,524 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Runs the audio code through a fixed set of scenarios, recording a hash of each one's output
+// along with how long it took to mix and how many voices it mixed. The results can be saved
+// as a baseline, and later runs compared against it, to catch changes that alter the output
+// or slow it down (slowdowns are only reported, since timings are noisy). Baselines are only
+// comparable between builds with the same audio options.
+// It also checks that stream fades stay close to the exact fade curve.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#include "../WindowsWrapper.h"
+
+#include "../Backends/Audio.h"
+#include "../Backends/Audio/SoftwareMixer/Mixer.h"
+#include "../Backends/Audio/SoftwareMixer/Offline.h"
+#ifdef EXTRA_SOUND_FORMATS
+#include "../ExtraSoundFormats.h"
+#endif
+#include "../Main.h"
+#include "../Organya.h"
+#include "../Sound.h"
+#include "Render.h"
+
+#define BENCH_PERIOD 0x400	// Frames mixed at a time, like an audio device would ask for
+#define MAX_SCENARIOS 0x40
+#define REPEATS 5	// Each scenario is played this many times, and the fastest time is kept
+#define FIRST_PIXTONE 1
+#define LAST_PIXTONE 159
+#define FADE_CHECK_MILLISECONDS 1000
+#define FADE_CHECK_TOLERANCE 2	// How far a faded sample may be from fading each frame on its own, out of 0x7FFF
+
+// The same songs as music_table_organya in Stage.cpp
+static const char* const songs[] = {
+	"XXXX", "Wanpaku", "Anzen", "Gameover", "Gravity", "Weed", "MDown2", "FireEye",
+	"Vivi", "Mura", "Fanfale1", "Ginsuke", "Cemetery", "Plant", "Kodou", "Fanfale3",
+	"Fanfale2", "Dr", "Escape", "Jenka", "Maze", "Access", "ironH", "Grand",
+	"Curly", "Oside", "Requiem", "Wanpak2", "quiet", "LastCave", "Balcony", "LastBtl",
+	"LastBtl3", "Ending", "Zonbie", "BreakDown", "Hell", "Jenka2", "Marine", "Ballos",
+	"Toroko", "White"
+};
+
+// Like the original, Organya carries the track volumes and note lengths over from one song to the
+// next, so they're reset to how they are when the game boots, to make every scenario repeatable
+extern int TrackVol[MAXTRACK];
+extern long now_leng[MAXMELODY];
+
+// Starts a scenario playing, or returns FALSE if it can't be played
+typedef BOOL (*ScenarioStart)(const char *argument);
+
+typedef struct Result
+{
+	std::string name;
+	unsigned long frames;
+	uint64_t hash;
+	double nanoseconds_per_frame;
+	double voices_per_frame;
+} Result;
+
+static Result results[MAX_SCENARIOS];
+static size_t total_results;
+
+static const char *program_path;
+static const char *data_path;
+static unsigned long sample_rate = 48000;
+static int longest_pixtone;	// In samples
+static unsigned long fade_check_position;	// In frames
+
+static void PrintUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"\n"
+		"Options:\n"
+		"  -d <folder>   The game's data folder (default: 'data' next to this program)\n"
+		"  -r <rate>     Sample rate (default: 48000)\n"
+		"  -s <seconds>  How long to play each song for (default: 10)\n"
+		"  -e <file>     Also play this file as an ExtraSound stream\n"
+		"  -w <file>     Save the results as a baseline\n"
+		"  -c <file>     Compare the results against a baseline\n"
+		"  -t <percent>  How much slower than the baseline a scenario may be before it's reported (default: 10)\n"
+		, argv0);
+}
+
+// Starts the mixer from scratch, so that nothing left over from the last scenario can affect the next one
+static BOOL StartAudio(void)
+{
+	if (!Render_Init(program_path, data_path, sample_rate))
+		return FALSE;
+
+	// Load every PixTone sound, like LoadGenericData does, including the drums
+	longest_pixtone = 0;
+
+	for (int i = FIRST_PIXTONE; i <= LAST_PIXTONE; ++i)
+	{
+		char pixtone_path[0x20];
+		sprintf(pixtone_path, "/PixTone/%03d.pxt", i);
+
+		const int sample_count = Render_LoadPixTone((gDataPath + pixtone_path).c_str(), i);
+
+		if (sample_count > longest_pixtone)
+			longest_pixtone = sample_count;
+	}
+
+	return TRUE;
+}
+
+// Mixes `frames` frames of the scenario a few times over, and records its results.
+// Every repeat has to produce the same output, or else the mixer isn't deterministic.
+static void RunScenario(const std::string &name, ScenarioStart start, const char *argument, unsigned long frames)
+{
+	short stream[BENCH_PERIOD * 2];
+	uint64_t hash = 0;
+	uint64_t voice_frames = 0;
+	clock_t best_time = 0;
+
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+	{
+		if (!StartAudio())
+			return;
+
+		if (!start(argument))
+		{
+			Render_Deinit();
+			return;
+		}
+
+		uint64_t repeat_hash = 14695981039346656037ULL;	// FNV-1a
+		const uint64_t voice_frames_before = Mixer_GetVoiceFramesMixed();
+		clock_t time_taken = 0;
+
+		for (unsigned long frames_done = 0; frames_done < frames;)
+		{
+			const unsigned long frames_to_do = frames - frames_done < BENCH_PERIOD ? frames - frames_done : BENCH_PERIOD;
+
+			// Only the mixing is timed, not the hashing
+			const clock_t start_time = clock();
+			SoftwareMixerBackend_Render(stream, frames_to_do);
+			time_taken += clock() - start_time;
+
+			for (unsigned long i = 0; i < frames_to_do * 2; ++i)
+			{
+				repeat_hash ^= (unsigned short)stream[i];
+				repeat_hash *= 1099511628211ULL;
+			}
+
+			frames_done += frames_to_do;
+		}
+
+		if (repeat == 0)
+		{
+			hash = repeat_hash;
+			voice_frames = Mixer_GetVoiceFramesMixed() - voice_frames_before;
+			best_time = time_taken;
+		}
+		else
+		{
+			if (repeat_hash != hash)
+				fprintf(stderr, "'%s' sounded different when it was played again\n", name.c_str());
+
+			if (time_taken < best_time)
+				best_time = time_taken;
+		}
+
+		Render_Deinit();
+	}
+
+	if (total_results == MAX_SCENARIOS)
+		return;
+
+	Result *result = &results[total_results++];
+	result->name = name;
+	result->frames = frames;
+	result->hash = hash;
+	result->nanoseconds_per_frame = (double)best_time / CLOCKS_PER_SEC * 1000000000.0 / frames;
+	result->voices_per_frame = (double)voice_frames / frames;
+
+	printf("%-20s %016llx %10.1f ns/frame %7.2f voices/frame\n", result->name.c_str(), (unsigned long long)result->hash, result->nanoseconds_per_frame, result->voices_per_frame);
+}
+
+// Plays a song the way ChangeMusic does
+static BOOL StartSong(const char *name)
+{
+	long repeat_x, end_x;
+	unsigned short wait;
+
+	const std::string path = gDataPath + "/Resource/ORG/" + name + ".org";
+
+	StopOrganyaMusic();
+	memset(TrackVol, 0, sizeof(TrackVol));
+	memset(now_leng, 0, sizeof(now_leng));
+
+	LoadOrganya(path.c_str());
+
+	if (!GetOrganyaLoop(&repeat_x, &end_x, &wait))
+	{
+		fprintf(stderr, "Could not load '%s'\n", path.c_str());
+		return FALSE;
+	}
+
+	ChangeOrganyaVolume(100);
+	SetOrganyaPosition(0);
+	PlayOrganyaMusic();
+
+	return TRUE;
+}
+
+// Plays every PixTone sound at once
+static BOOL StartPixToneBurst(const char *argument)
+{
+	(void)argument;
+
+	for (int i = FIRST_PIXTONE; i <= LAST_PIXTONE; ++i)
+		if (lpSECONDARYBUFFER[i] != NULL)
+			PlaySoundObject(i, SOUND_MODE_PLAY);
+
+	return TRUE;
+}
+
+#ifdef EXTRA_SOUND_FORMATS
+// Streams a file the way ChangeMusic does with the other soundtracks
+static BOOL StartExtraSound(const char *path)
+{
+	ExtraSound_Play();
+	ExtraSound_LoadMusic(path, NULL, true);
+	ExtraSound_SetMusicVolume(0x100);
+	ExtraSound_UnpauseMusic();
+
+	return TRUE;
+}
+#endif
+
+// A loud sawtooth, inverted on the right, so that rounding errors show up at every level
+static short GetFadeCheckSample(unsigned long position, int channel)
+{
+	const short sample = (short)((long)((position * 397) % 0xFFFF) - 0x7FFF);
+
+	return channel == 0 ? sample : -sample;
+}
+
+static size_t FadeCheckCallback(void *user_data, short *buffer, size_t frames)
+{
+	(void)user_data;
+
+	for (size_t i = 0; i < frames; ++i)
+	{
+		buffer[i * 2 + 0] = GetFadeCheckSample(fade_check_position, 0);
+		buffer[i * 2 + 1] = GetFadeCheckSample(fade_check_position, 1);
+		++fade_check_position;
+	}
+
+	return frames;
+}
+
+// Stream fades are worked out once per block of frames and ramped in between, so check how far they
+// are from the exact curve that fading every frame on its own would give.
+// Returns the biggest difference, or -1 if the check couldn't be run.
+static int CheckStreamFade(void)
+{
+	short stream[BENCH_PERIOD * 2];
+	int max_error = 0;
+
+	if (!StartAudio())
+		return -1;
+
+	AudioBackend_Sound *sound = AudioBackend_CreateStream(FadeCheckCallback, NULL);
+
+	if (sound == NULL)
+	{
+		Render_Deinit();
+		return -1;
+	}
+
+	fade_check_position = 0;
+
+	AudioBackend_SetStreamVolume(sound, 0x100);
+	AudioBackend_PlaySound(sound, false);
+	AudioBackend_FadeOutStream(sound, FADE_CHECK_MILLISECONDS);
+
+	// Carry on for a little past the end of the fade, to check that it stays silent
+	const unsigned long fade_out_frames = (sample_rate * FADE_CHECK_MILLISECONDS) / 1000;
+	const unsigned long frames = fade_out_frames + BENCH_PERIOD;
+
+	for (unsigned long frames_done = 0; frames_done < frames;)
+	{
+		const unsigned long frames_to_do = frames - frames_done < BENCH_PERIOD ? frames - frames_done : BENCH_PERIOD;
+
+		SoftwareMixerBackend_Render(stream, frames_to_do);
+
+		for (unsigned long i = 0; i < frames_to_do; ++i)
+		{
+			const unsigned long position = frames_done + i;
+			const double fade_volume = position < fade_out_frames ? (double)(fade_out_frames - position) / fade_out_frames : 0.0;
+
+			for (int channel = 0; channel < 2; ++channel)
+			{
+				const int expected = (int)floor(GetFadeCheckSample(position, channel) * fade_volume * fade_volume);
+				const int error = abs(stream[i * 2 + channel] - expected);
+
+				if (error > max_error)
+					max_error = error;
+			}
+		}
+
+		frames_done += frames_to_do;
+	}
+
+	AudioBackend_DestroySound(sound);
+	Render_Deinit();
+
+	return max_error;
+}
+
+static BOOL SaveBaseline(const char *path)
+{
+	FILE *file = fopen(path, "w");
+
+	if (file == NULL)
+		return FALSE;
+
+	for (size_t i = 0; i < total_results; ++i)
+		fprintf(file, "%s %lu %016llx %.1f %.4f\n", results[i].name.c_str(), results[i].frames, (unsigned long long)results[i].hash, results[i].nanoseconds_per_frame, results[i].voices_per_frame);
+
+	fclose(file);
+
+	return TRUE;
+}
+
+// Returns how many scenarios sound different from the baseline or mix a different number of voices, or -1 if the baseline couldn't be read
+static int CompareBaseline(const char *path, double tolerance_percent)
+{
+	char name[0x40];
+	unsigned long frames;
+	unsigned long long hash;
+	double nanoseconds_per_frame;
+	double voices_per_frame;
+	int failures = 0;
+
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL)
+		return -1;
+
+	while (fscanf(file, "%63s %lu %llx %lf %lf", name, &frames, &hash, &nanoseconds_per_frame, &voices_per_frame) == 5)
+	{
+		const Result *result = NULL;
+
+		for (size_t i = 0; i < total_results; ++i)
+			if (results[i].name == name)
+				result = &results[i];
+
+		if (result == NULL)
+		{
+			printf("%-20s MISSING\n", name);
+			++failures;
+		}
+		else if (result->frames != frames)
+		{
+			printf("%-20s DIFFERENT LENGTH (baseline used different -s or -r options)\n", name);
+			++failures;
+		}
+		else if (result->hash != hash)
+		{
+			printf("%-20s OUTPUT CHANGED\n", name);
+			++failures;
+		}
+		else if (result->voices_per_frame - voices_per_frame > 0.0001 || voices_per_frame - result->voices_per_frame > 0.0001)
+		{
+			printf("%-20s VOICE COUNT CHANGED (%.2f voices/frame, was %.2f)\n", name, result->voices_per_frame, voices_per_frame);
+			++failures;
+		}
+		else if (result->nanoseconds_per_frame > nanoseconds_per_frame * (1.0 + tolerance_percent / 100.0))
+		{
+			// Timings vary too much from run to run to fail on, especially on a busy machine, so this is only a warning
+			printf("%-20s SLOWER (%.1f ns/frame, was %.1f)\n", name, result->nanoseconds_per_frame, nanoseconds_per_frame);
+		}
+	}
+
+	fclose(file);
+
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *extra_sound_path = NULL;
+	const char *save_path = NULL;
+	const char *compare_path = NULL;
+	double seconds = 10.0;
+	double tolerance_percent = 10.0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 == argc)
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		const char *value = argv[++i];
+
+		switch (argv[i - 1][1])
+		{
+			case 'd':
+				data_path = value;
+				break;
+
+			case 'r':
+				sample_rate = strtoul(value, NULL, 10);
+				break;
+
+			case 's':
+				seconds = strtod(value, NULL);
+				break;
+
+			case 'e':
+				extra_sound_path = value;
+				break;
+
+			case 'w':
+				save_path = value;
+				break;
+
+			case 'c':
+				compare_path = value;
+				break;
+
+			case 't':
+				tolerance_percent = strtod(value, NULL);
+				break;
+
+			default:
+				PrintUsage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (sample_rate == 0 || seconds <= 0.0)
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+#ifndef EXTRA_SOUND_FORMATS
+	if (extra_sound_path != NULL)
+	{
+		fprintf(stderr, "This build doesn't support ExtraSound streams (it needs EXTRA_SOUND_FORMATS)\n");
+		return EXIT_FAILURE;
+	}
+#endif
+
+	program_path = argv[0];
+
+	// Make sure that the mixer starts at all, and find out how long the longest PixTone sound is
+	if (!StartAudio())
+		return EXIT_FAILURE;
+
+	Render_Deinit();
+
+	const unsigned long song_frames = (unsigned long)(seconds * sample_rate);
+
+	for (size_t i = 0; i < sizeof(songs) / sizeof(songs[0]); ++i)
+		RunScenario(std::string("org:") + songs[i], StartSong, songs[i], song_frames);
+
+	// PixTone sounds are 22050Hz
+	if (longest_pixtone > 0)
+		RunScenario("pixtone-burst", StartPixToneBurst, NULL, (unsigned long)((double)longest_pixtone * sample_rate / 22050) + 1);
+
+#ifdef EXTRA_SOUND_FORMATS
+	if (extra_sound_path != NULL)
+		RunScenario("extrasound", StartExtraSound, extra_sound_path, song_frames);
+#endif
+
+	const int fade_error = CheckStreamFade();
+
+	if (fade_error < 0)
+	{
+		fprintf(stderr, "Could not check stream fades\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%-20s %d away from fading every frame separately (at most %d allowed)\n", "stream-fade", fade_error, FADE_CHECK_TOLERANCE);
+
+	if (save_path != NULL && !SaveBaseline(save_path))
+	{
+		fprintf(stderr, "Could not save the baseline to '%s'\n", save_path);
+		return EXIT_FAILURE;
+	}
+
+	if (compare_path != NULL)
+	{
+		const int failures = CompareBaseline(compare_path, tolerance_percent);
+
+		if (failures < 0)
+		{
+			fprintf(stderr, "Could not read the baseline at '%s'\n", compare_path);
+			return EXIT_FAILURE;
+		}
+
+		if (failures != 0)
+		{
+			printf("%d scenario(s) don't match the baseline\n", failures);
+			return EXIT_FAILURE;
+		}
+
+		printf("Everything matches the baseline\n");
+	}
+
+	if (fade_error > FADE_CHECK_TOLERANCE)
+	{
+		printf("Stream fades are too far from fading every frame separately\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
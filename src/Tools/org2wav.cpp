@@ -0,0 +1,161 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Renders an Organya song to a WAV file, through the same code the game uses to play it
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "../WindowsWrapper.h"
+
+#include "../Main.h"
+#include "../Organya.h"
+#include "Render.h"
+
+static void PrintUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <input.org> <output.wav>\n"
+		"\n"
+		"Options:\n"
+		"  -d <folder>  The game's data folder, for the instruments and drums (default: 'data' next to this program)\n"
+		"  -r <rate>    Sample rate (default: 48000)\n"
+		"  -l <loops>   How many times to play the song's looping part (default: 1)\n"
+		"  -m <track>   Mute a track (0-7 are the melody tracks, 8-15 are the drums). Can be used more than once.\n"
+		, argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *data_path = NULL;
+	unsigned long sample_rate = 48000;
+	long loops = 1;
+	BOOL mute[MAXTRACK];
+	const char *input_path = NULL;
+	const char *output_path = NULL;
+
+	memset(mute, 0, sizeof(mute));
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-' && argv[i][1] != '\0')
+		{
+			if (argv[i][2] != '\0' || i + 1 == argc)
+			{
+				PrintUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+
+			const char *value = argv[++i];
+
+			switch (argv[i - 1][1])
+			{
+				case 'd':
+					data_path = value;
+					break;
+
+				case 'r':
+					sample_rate = strtoul(value, NULL, 10);
+					break;
+
+				case 'l':
+					loops = strtol(value, NULL, 10);
+					break;
+
+				case 'm':
+				{
+					const long track = strtol(value, NULL, 10);
+
+					if (track < 0 || track >= MAXTRACK)
+					{
+						fprintf(stderr, "There is no track %ld\n", track);
+						return EXIT_FAILURE;
+					}
+
+					mute[track] = TRUE;
+					break;
+				}
+
+				default:
+					PrintUsage(argv[0]);
+					return EXIT_FAILURE;
+			}
+		}
+		else if (input_path == NULL)
+		{
+			input_path = argv[i];
+		}
+		else if (output_path == NULL)
+		{
+			output_path = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (input_path == NULL || output_path == NULL || sample_rate == 0 || loops < 0)
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!Render_Init(argv[0], data_path, sample_rate))
+		return EXIT_FAILURE;
+
+	// StartOrganya doesn't complain if the instruments are missing, so check for them here
+	const std::string wave_path = gDataPath + "/Resource/WAVE/Wave.dat";
+	FILE *wave_file = fopen(wave_path.c_str(), "rb");
+
+	if (wave_file == NULL)
+	{
+		fprintf(stderr, "Could not find the instruments at '%s'\n", wave_path.c_str());
+		Render_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	fclose(wave_file);
+
+	// The drums are PixTone sounds, which the game loads at startup
+	for (int i = 0; i < MAXDRAM; ++i)
+	{
+		char drum_path[0x20];
+		sprintf(drum_path, "/PixTone/%03d.pxt", 150 + i);
+		Render_LoadPixTone((gDataPath + drum_path).c_str(), 150 + i);
+	}
+
+	for (int i = 0; i < MAXTRACK; ++i)
+		g_mute[i] = mute[i];
+
+	long repeat_x, end_x;
+	unsigned short wait;
+
+	LoadOrganya(input_path);
+
+	if (!GetOrganyaLoop(&repeat_x, &end_x, &wait))
+	{
+		fprintf(stderr, "Could not load '%s'\n", input_path);
+		Render_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	// Same as the game's ChangeMusic
+	SetOrganyaPosition(0);
+	ChangeOrganyaVolume(100);
+	PlayOrganyaMusic();
+
+	// The mixer steps Organya every 'wait' milliseconds, rounded down to a whole number of frames
+	const size_t frames_per_beat = (size_t)wait * sample_rate / 1000;
+	const size_t frames = (size_t)(repeat_x + loops * (end_x - repeat_x)) * frames_per_beat;
+
+	const BOOL success = Render_ToWAV(output_path, frames);
+
+	Render_Deinit();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Renders a PixTone sound to a WAV file, through the same code the game uses to play it
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../WindowsWrapper.h"
+
+#include "../Sound.h"
+#include "Render.h"
+
+#define SOUND_SLOT 1
+
+static void PrintUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <input.pxt> <output.wav>\n"
+		"\n"
+		"Options:\n"
+		"  -r <rate>    Sample rate (default: 48000)\n"
+		"  -l <loops>   How many times to play the sound back-to-back (default: 1)\n"
+		, argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long sample_rate = 48000;
+	long loops = 1;
+	const char *input_path = NULL;
+	const char *output_path = NULL;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-' && argv[i][1] != '\0')
+		{
+			if (argv[i][2] != '\0' || i + 1 == argc)
+			{
+				PrintUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+
+			const char *value = argv[++i];
+
+			switch (argv[i - 1][1])
+			{
+				case 'r':
+					sample_rate = strtoul(value, NULL, 10);
+					break;
+
+				case 'l':
+					loops = strtol(value, NULL, 10);
+					break;
+
+				default:
+					PrintUsage(argv[0]);
+					return EXIT_FAILURE;
+			}
+		}
+		else if (input_path == NULL)
+		{
+			input_path = argv[i];
+		}
+		else if (output_path == NULL)
+		{
+			output_path = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (input_path == NULL || output_path == NULL || sample_rate == 0 || loops < 1)
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// PixTone sounds don't need anything from the data folder
+	if (!Render_Init(argv[0], NULL, sample_rate))
+		return EXIT_FAILURE;
+
+	const int sample_count = Render_LoadPixTone(input_path, SOUND_SLOT);
+
+	if (sample_count <= 0)
+	{
+		fprintf(stderr, "Could not load '%s'\n", input_path);
+		Render_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	PlaySoundObject(SOUND_SLOT, loops > 1 ? SOUND_MODE_PLAY_LOOP : SOUND_MODE_PLAY);
+
+	// PixTone sounds are always 22050Hz, so round up to fit all of the last sample in
+	const size_t frames = ((size_t)sample_count * loops * sample_rate + 22050 - 1) / 22050;
+
+	const BOOL success = Render_ToWAV(output_path, frames);
+
+	Render_Deinit();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,291 @@
+// Released under the MIT licence.
+// See LICENCE.txt for details.
+
+// Renders every PixTone sound in a folder through both the floating-point and fixed-point
+// (FIXED_POINT_PIXTONE) kernels, and reports how far apart they are. The report can be saved,
+// and later runs compared against it, to catch changes to either kernel's output.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../WindowsWrapper.h"
+
+#include "../PixTone.h"
+
+#define MAX_SOUNDS 1000
+#define MAX_RESULTS (MAX_SOUNDS * 4)
+
+typedef struct Result
+{
+	char name[0x10];	// The file's number, and which of its four channels this is
+	long samples;
+	long different_samples;
+	int max_error;
+	double signal;	// Sums of squares, for the signal-to-noise ratio
+	double noise;
+} Result;
+
+static Result results[MAX_RESULTS];
+static size_t total_results;
+
+static void PrintUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <PixTone folder>\n"
+		"\n"
+		"Options:\n"
+		"  -w <file>   Save the results\n"
+		"  -c <file>   Compare the results against a saved file, and fail if they differ\n"
+		, argv0);
+}
+
+// In decibels, or a large number if the kernels match
+static double GetSNR(double signal, double noise)
+{
+	return noise == 0.0 ? 999.0 : 10.0 * log10(signal / noise);
+}
+
+static BOOL CompareSound(const char *name, const PIXTONEPARAMETER *ptp)
+{
+	unsigned char *floating_point = (unsigned char*)malloc(ptp->size);
+	unsigned char *fixed_point = (unsigned char*)malloc(ptp->size);
+
+	if (floating_point == NULL || fixed_point == NULL)
+	{
+		free(floating_point);
+		free(fixed_point);
+		return FALSE;
+	}
+
+	MakePixelWaveData_Kernel(ptp, floating_point, FALSE);
+	MakePixelWaveData_Kernel(ptp, fixed_point, TRUE);
+
+	Result *result = &results[total_results++];
+
+	strcpy(result->name, name);
+	result->samples = ptp->size;
+	result->different_samples = 0;
+	result->max_error = 0;
+	result->signal = 0.0;
+	result->noise = 0.0;
+
+	for (int i = 0; i < ptp->size; ++i)
+	{
+		const int error = abs(fixed_point[i] - floating_point[i]);
+
+		if (error != 0)
+			++result->different_samples;
+
+		if (error > result->max_error)
+			result->max_error = error;
+
+		result->signal += (floating_point[i] - 128.0) * (floating_point[i] - 128.0);
+		result->noise += (double)error * error;
+	}
+
+	free(floating_point);
+	free(fixed_point);
+
+	return TRUE;
+}
+
+static void PrintResults(FILE *file)
+{
+	long samples = 0;
+	long different_samples = 0;
+	int max_error = 0;
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (size_t i = 0; i < total_results; ++i)
+	{
+		fprintf(file, "%s %ld %ld %d %.1f\n", results[i].name, results[i].samples, results[i].different_samples, results[i].max_error, GetSNR(results[i].signal, results[i].noise));
+
+		samples += results[i].samples;
+		different_samples += results[i].different_samples;
+		max_error = results[i].max_error > max_error ? results[i].max_error : max_error;
+		signal += results[i].signal;
+		noise += results[i].noise;
+	}
+
+	fprintf(file, "total %ld %ld %d %.1f\n", samples, different_samples, max_error, GetSNR(signal, noise));
+}
+
+// Returns how many sounds differ from the saved results, or -1 if they couldn't be read
+static int CompareResults(const char *path)
+{
+	char name[0x10];
+	long samples;
+	long different_samples;
+	int max_error;
+	double snr;
+	int failures = 0;
+
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL)
+		return -1;
+
+	while (fscanf(file, "%15s %ld %ld %d %lf", name, &samples, &different_samples, &max_error, &snr) == 5)
+	{
+		if (strcmp(name, "total") == 0)
+			continue;
+
+		const Result *result = NULL;
+
+		for (size_t i = 0; i < total_results; ++i)
+			if (strcmp(results[i].name, name) == 0)
+				result = &results[i];
+
+		if (result == NULL)
+		{
+			printf("%-8s MISSING\n", name);
+			++failures;
+		}
+		else if (result->samples != samples || result->different_samples != different_samples || result->max_error != max_error)
+		{
+			printf("%-8s CHANGED (%ld of %ld samples differ by up to %d, was %ld of %ld by up to %d)\n", name, result->different_samples, result->samples, result->max_error, different_samples, samples, max_error);
+			++failures;
+		}
+	}
+
+	fclose(file);
+
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *folder_path = NULL;
+	const char *save_path = NULL;
+	const char *compare_path = NULL;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-' && argv[i][1] != '\0')
+		{
+			if (argv[i][2] != '\0' || i + 1 == argc)
+			{
+				PrintUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+
+			const char *value = argv[++i];
+
+			switch (argv[i - 1][1])
+			{
+				case 'w':
+					save_path = value;
+					break;
+
+				case 'c':
+					compare_path = value;
+					break;
+
+				default:
+					PrintUsage(argv[0]);
+					return EXIT_FAILURE;
+			}
+		}
+		else if (folder_path == NULL)
+		{
+			folder_path = argv[i];
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (folder_path == NULL)
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (int no = 0; no < MAX_SOUNDS; ++no)
+	{
+		char path[0x400];
+		PIXTONEPARAMETER ptp[4];
+
+		sprintf(path, "%.*s/%03d.pxt", (int)sizeof(path) - 0x10, folder_path, no);
+
+		FILE *file = fopen(path, "rb");
+
+		if (file == NULL)
+			continue;
+
+		fclose(file);
+
+		memset(ptp, 0, sizeof(ptp));
+
+		if (!LoadPixToneFile(path, ptp))
+		{
+			fprintf(stderr, "Could not load '%s'\n", path);
+			return EXIT_FAILURE;
+		}
+
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			char name[0x10];
+
+			if (!ptp[channel].use || ptp[channel].size <= 0)
+				continue;
+
+			sprintf(name, "%03d.%d", no, channel);
+
+			if (!CompareSound(name, &ptp[channel]))
+			{
+				fprintf(stderr, "Could not allocate memory for '%s'\n", path);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (total_results == 0)
+	{
+		fprintf(stderr, "Could not find any PixTone sounds in '%s'\n", folder_path);
+		return EXIT_FAILURE;
+	}
+
+	PrintResults(stdout);
+
+	if (save_path != NULL)
+	{
+		FILE *file = fopen(save_path, "w");
+
+		if (file == NULL)
+		{
+			fprintf(stderr, "Could not save the results to '%s'\n", save_path);
+			return EXIT_FAILURE;
+		}
+
+		PrintResults(file);
+		fclose(file);
+	}
+
+	if (compare_path != NULL)
+	{
+		const int failures = CompareResults(compare_path);
+
+		if (failures < 0)
+		{
+			fprintf(stderr, "Could not read the results at '%s'\n", compare_path);
+			return EXIT_FAILURE;
+		}
+
+		if (failures != 0)
+		{
+			printf("%d sound(s) don't match the saved results\n", failures);
+			return EXIT_FAILURE;
+		}
+
+		printf("Every sound matches the saved results\n");
+	}
+
+	return EXIT_SUCCESS;
+}